@@ -0,0 +1,164 @@
+#! /usr/bin/env python3
+#
+# barricelli54.py
+# A Python interface to the barricelli54 simulation engine, through the C
+# interface of the shared library build/libbarricelli54.so (see
+# src/b54capi.h), built by the compile script.
+#
+# The history of a run is written by the engine straight into a NumPy
+# array, one row per generation, so nothing is copied or parsed:
+#
+#   import barricelli54 as b54
+#   u = b54.Universe.from_figure(8)
+#   history = u.run(u.num_gens - 1)      # int32 array of shape (gens, size)
+#   (history == b54.X_MARK).sum(axis=1)  # X_MARKs in each generation
+#
+# Long runs can be driven in blocks, reusing one array:
+#
+#   block = np.empty((1000, u.size), dtype=np.int32)
+#   for _ in range(1000):
+#       u.run(1000, out=block)
+#       ... analyse block ...
+#
+# The engine runs without holding the GIL, so universes can be stepped
+# concurrently from several Python threads. The library is looked for in
+# the build directory next to this file, unless B54_LIBRARY gives its path.
+#
+# This program is distributed under the GNU GPLv3 license. For full
+# information, see the LICENSE file included in the base directory of
+# this distribution.
+
+import ctypes
+import os
+
+import numpy as np
+
+X_MARK = 99999
+
+NORMS = {'basic': 0, 'symbiotic': 1, 'exclusion': 2, 'conditional': 3}
+
+_lib_path = os.environ.get('B54_LIBRARY',
+                           os.path.join(os.path.dirname(os.path.abspath(__file__)), 'build', 'libbarricelli54.so'))
+_lib = ctypes.CDLL(_lib_path)
+
+_int32_p = ctypes.POINTER(ctypes.c_int32)
+
+_lib.b54_last_error.restype = ctypes.c_char_p
+_lib.b54_last_error.argtypes = []
+_lib.b54_create.restype = ctypes.c_void_p
+_lib.b54_create.argtypes = [ctypes.c_int, ctypes.c_int, _int32_p, ctypes.c_int]
+_lib.b54_create_scenario.restype = ctypes.c_void_p
+_lib.b54_create_scenario.argtypes = [ctypes.c_int, ctypes.c_uint, ctypes.POINTER(ctypes.c_int)]
+_lib.b54_destroy.restype = None
+_lib.b54_destroy.argtypes = [ctypes.c_void_p]
+_lib.b54_world_size.restype = ctypes.c_int
+_lib.b54_world_size.argtypes = [ctypes.c_void_p]
+_lib.b54_norm.restype = ctypes.c_int
+_lib.b54_norm.argtypes = [ctypes.c_void_p]
+_lib.b54_generation.restype = ctypes.c_longlong
+_lib.b54_generation.argtypes = [ctypes.c_void_p]
+_lib.b54_set_sparse.restype = ctypes.c_int
+_lib.b54_set_sparse.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.b54_set_threads.restype = ctypes.c_int
+_lib.b54_set_threads.argtypes = [ctypes.c_void_p, ctypes.c_uint]
+_lib.b54_state.restype = ctypes.c_int
+_lib.b54_state.argtypes = [ctypes.c_void_p, _int32_p]
+_lib.b54_run.restype = ctypes.c_int
+_lib.b54_run.argtypes = [ctypes.c_void_p, ctypes.c_longlong, _int32_p]
+
+
+def _check(ok):
+    """Raises the engine's last error if a call failed."""
+    if not ok:
+        raise ValueError(_lib.b54_last_error().decode())
+
+
+def _buffer(out, shape):
+    """Checks that out is a writable C-contiguous int32 array of the given
+    shape (or makes one if out is None), returning it and a pointer to it."""
+    if out is None:
+        out = np.empty(shape, dtype=np.int32)
+    elif (out.dtype != np.int32 or out.shape != shape
+          or not out.flags['C_CONTIGUOUS'] or not out.flags['WRITEABLE']):
+        raise ValueError(f"out must be a writable C-contiguous int32 array of shape {shape}")
+    return out, out.ctypes.data_as(_int32_p)
+
+
+class Universe:
+    """A universe of the simulation engine (see src/universe.h)."""
+
+    def __init__(self, size, norm='basic', init=()):
+        """Creates a universe of size cells under the given norm ('basic',
+        'symbiotic', 'exclusion' or 'conditional'), whose first cells are set
+        from init."""
+        if norm not in NORMS:
+            raise ValueError(f"Unknown norm: {norm}")
+        init = np.ascontiguousarray(init, dtype=np.int32)
+        self._handle = _lib.b54_create(size, NORMS[norm], init.ctypes.data_as(_int32_p), len(init))
+        _check(self._handle)
+        self.num_gens = None
+
+    @classmethod
+    def from_figure(cls, fig, seed=0):
+        """Creates a universe set up as the given figure (1-22) or test case
+        of barricelli54, drawing a random initial state from seed. Its
+        num_gens attribute gives the number of generations in the figure."""
+        self = cls.__new__(cls)
+        num_gens = ctypes.c_int(0)
+        self._handle = _lib.b54_create_scenario(fig, seed, ctypes.byref(num_gens))
+        _check(self._handle)
+        self.num_gens = num_gens.value
+        return self
+
+    def close(self):
+        """Frees the universe (which is also done when it is garbage collected)."""
+        if getattr(self, '_handle', None):
+            _lib.b54_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    @property
+    def size(self):
+        return _lib.b54_world_size(self._handle)
+
+    @property
+    def norm(self):
+        return next(name for name, n in NORMS.items() if n == _lib.b54_norm(self._handle))
+
+    @property
+    def generation(self):
+        return _lib.b54_generation(self._handle)
+
+    def set_sparse(self, on=True):
+        """Selects sparse execution (the results are the same)."""
+        _check(_lib.b54_set_sparse(self._handle, int(on)) == 0)
+
+    def set_threads(self, n):
+        """Sets the number of threads computing each generation (the results are the same)."""
+        _check(_lib.b54_set_threads(self._handle, n) == 0)
+
+    def state(self, out=None):
+        """Returns the current world as an int32 array (written into out if given)."""
+        out, ptr = _buffer(out, (self.size,))
+        _check(_lib.b54_state(self._handle, ptr) == 0)
+        return out
+
+    def run(self, steps, out=None, history=True):
+        """Advances the universe by steps generations, returning an int32
+        array of shape (steps, size) holding the world after each step
+        (written into out if given). With history=False, nothing is
+        recorded and None is returned."""
+        if not history:
+            _check(_lib.b54_run(self._handle, steps, None) == 0)
+            return None
+        out, ptr = _buffer(out, (steps, self.size))
+        _check(_lib.b54_run(self._handle, steps, ptr) == 0)
+        return out
@@ -0,0 +1,526 @@
+// b54bench
+//
+// Benchmarks the update kernels of the simulation engine, measuring the
+// generations per second and cells per second (world size times
+// generations per second) of each norm, and optionally compares the results
+// with a baseline recorded by an earlier build so that slowdowns are caught
+// before a new build is rolled out.
+//
+// Three kinds of case are run:
+//   random  a world of each size 10^2 .. 10^maxexp in which each cell holds
+//           a number (uniform in -10..10, excluding 0) with the given
+//           probability (the density), for each norm
+//   random-scalar
+//           the basic-norm random worlds again, with the vectorised basic
+//           kernel turned off (see basic_kernel.h), so that the speedup of
+//           the kernel chosen for the CPU over the scalar one is shown
+//           (not run with -p or -t, as sparse and threaded execution use
+//           neither)
+//   figN    the scenario of each figure and test case of scenarios.h,
+//           run from its initial state for its number of generations
+//           as many times as is needed to do a comparable amount of work
+// Every case is deterministic (the random worlds are drawn from a fixed
+// seed), so the same work is timed by every build. Each case is run -n
+// times and the fastest run is reported.
+//
+// Usage:
+//   > b54bench [-p] [-t threads] [-m maxexp] [-d densities] [-w work] [-n reps] [-R|-F] [-b file [-T percent]]
+// where:
+//   -p Time sparse execution (see barricelli54 -p)
+//   -t Number of threads used to compute each generation (default: 1)
+//   -m Largest world size of the random cases is 10^maxexp, for maxexp
+//      from 2 to 8 (default: 6)
+//   -d Comma-separated densities of the random cases (default: 0.01,0.1,0.5)
+//   -w Number of cell updates (world size times generations) timed in each
+//      case (default: 4000000). Each random case runs for at least 4
+//      generations, so the largest worlds may do more
+//   -n Number of times each case is run (default: 3)
+//   -R Run only the random cases
+//   -F Run only the figure cases
+//   -b Compare the results with the baseline in the given file (the output
+//      of an earlier run of b54bench). The comparison is printed to standard
+//      error, and the exit status is 2 if any case common to both is slower
+//      than in the baseline by more than -T percent (default: 10), which
+//      takes precedence over the exit status 3 described below
+//
+// The results are written to standard output as CSV, one line per case,
+// with the columns case,norm,size,density,generations,seconds,gens_per_sec,
+// cells_per_sec,allocs_per_gen. A baseline is made by saving this output to
+// a file, e.g. bench/baseline.csv.
+//
+// The last column is the number of heap allocations (calls to the global
+// operator new, which this program counts) per generation of the case in the
+// steady state of the universe. The buffers of a universe grow until they
+// reach the working size of its run, which for the side table of wide
+// values may take many generations (see Universe::Universe()), so the case
+// is run once more, untimed, and then again from its initial state in the
+// same universe, counting the allocations. This should be 0, as the
+// generation loop of the engine allocates nothing once its buffers have
+// grown; if it is not, the case is reported to standard error and the exit
+// status is 3. That is only checked on one thread (without -t): on more,
+// which thread writes each wide value, and so which of the per-thread pools
+// of the universe's memory serves it, varies from run to run.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format> // from C++20
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "random_state.h"
+#include "scenarios.h"
+#include "universe.h"
+
+struct Options {
+    bool sparse = false;
+    unsigned int stepThreads = 1;
+    int maxExp = 6;
+    std::vector<double> densities {0.01, 0.1, 0.5};
+    long long work = 4000000;
+    int reps = 3;
+    bool randomCases = true;
+    bool figureCases = true;
+    std::string baselineFile;
+    double tolerance = 10.0;
+};
+
+struct Result {
+    std::string name;
+    Norm norm = Norm::BASIC;
+    int size = 0;
+    double density = 0.0;
+    long long generations = 0;
+    double seconds = 0.0;
+    long long steadyGenerations = 0;  // generations of the rerun of the case in a grown universe
+    long long steadyAllocations = 0;  // heap allocations made in them
+};
+
+const Norm ALL_NORMS[] = {Norm::BASIC, Norm::SYMBIOTIC, Norm::EXCLUSION, Norm::CONDITIONAL};
+const unsigned int BENCH_SEED = 1954;
+
+// The number of calls to the global operator new so far
+std::atomic<long long> numAllocations { 0 };
+
+void printUsageAndExit(const std::string& progname, int rc);
+Options parseOptionsOrExit(int argc, char** argv);
+Result benchRandom(const Options& opts, Norm norm, int size, double density, bool scalar = false);
+Result benchScenario(const Options& opts, const Scenario& scenario);
+void countSteadyAllocations(Universe& universe, const std::vector<int>& initState, int numGens, Result& result);
+void printResult(std::ostream& os, const Result& result);
+std::string resultKey(const std::string& name, const std::string& norm, const std::string& size, const std::string& density);
+std::map<std::string, double> readBaseline(const std::string& filename);
+int compareWithBaseline(const std::string& filename, const std::map<std::string, double>& baseline,
+                        const std::vector<Result>& results, double tolerance);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    Options opts = parseOptionsOrExit(argc, argv);
+
+    int rc = 0;
+    try {
+        std::map<std::string, double> baseline;
+        if (!opts.baselineFile.empty()) {
+            baseline = readBaseline(opts.baselineFile);
+        }
+
+        std::vector<Result> results;
+        std::cout << "case,norm,size,density,generations,seconds,gens_per_sec,cells_per_sec,allocs_per_gen" << std::endl;
+
+        if (opts.randomCases) {
+            for (Norm norm : ALL_NORMS) {
+                int size = 100;
+                for (int e = 2; e <= opts.maxExp; ++e, size *= 10) {
+                    for (double density : opts.densities) {
+                        results.push_back(benchRandom(opts, norm, size, density));
+                        printResult(std::cout, results.back());
+                        if (norm == Norm::BASIC && !opts.sparse && opts.stepThreads == 1) {
+                            results.push_back(benchRandom(opts, norm, size, density, true));
+                            printResult(std::cout, results.back());
+                        }
+                    }
+                }
+            }
+        }
+
+        if (opts.figureCases) {
+            for (int fig = 1; fig <= NUM_RULES; ++fig) {
+                results.push_back(benchScenario(opts, makeScenario(fig, BENCH_SEED)));
+                printResult(std::cout, results.back());
+            }
+        }
+
+        for (const Result& result : results) {
+            if (result.steadyAllocations > 0 && opts.stepThreads == 1) {
+                std::cerr << std::format("{},{},{},{:.4f} allocated in its steady state", result.name,
+                    getNormName(result.norm), result.size, result.density) << std::endl;
+                rc = 3;
+            }
+        }
+
+        if (!opts.baselineFile.empty()) {
+            int compared = compareWithBaseline(opts.baselineFile, baseline, results, opts.tolerance);
+            if (compared != 0) {
+                rc = compared;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
+    }
+
+    return rc;
+}
+
+
+// Run f (which sets up and runs one case, returning the number of
+// generations it computed) opts.reps times, keeping the fastest time
+template <typename F>
+void timeCase(const Options& opts, Result& result, F&& f)
+{
+    for (int r = 0; r < opts.reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        result.generations = f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < result.seconds) {
+            result.seconds = elapsed.count();
+        }
+    }
+}
+
+
+Result benchRandom(const Options& opts, Norm norm, int size, double density, bool scalar)
+{
+    std::vector<int> initState = makeRandomState(size,
+        RandomStateOptions { .seed = BENCH_SEED, .density = density, .maxValue = 10 }, 0);
+
+    Result result;
+    result.name = scalar ? "random-scalar" : "random";
+    result.norm = norm;
+    result.size = size;
+    result.density = density;
+
+    auto makeUniverse = [&]() {
+        Universe universe(size, norm, initState);
+        universe.setSparse(opts.sparse);
+        universe.setThreads(opts.stepThreads);
+        universe.setVectorised(!scalar);
+        return universe;
+    };
+
+    int numGens = static_cast<int>(std::max<long long>(4, opts.work / size));
+    timeCase(opts, result, [&]() {
+        // constructing the universe is timed too, but is cheap beside the run
+        Universe universe = makeUniverse();
+        universe.run(numGens);
+        return static_cast<long long>(numGens);
+    });
+
+    Universe universe = makeUniverse();
+    countSteadyAllocations(universe, initState, numGens, result);
+    return result;
+}
+
+
+Result benchScenario(const Options& opts, const Scenario& scenario)
+{
+    Result result;
+    result.name = std::format("fig{}", scenario.fig);
+    result.norm = scenario.norm;
+    result.size = scenario.worldSize;
+    result.density = static_cast<double>(std::count_if(scenario.initState.begin(), scenario.initState.end(),
+        [](int v) { return v != 0; })) / scenario.worldSize;
+
+    long long cellsPerRun = static_cast<long long>(scenario.worldSize) * std::max(1, scenario.numGens);
+    long long numRuns = std::max<long long>(1, opts.work / cellsPerRun);
+    auto makeUniverse = [&]() {
+        Universe universe(scenario.worldSize, scenario.norm, scenario.initState);
+        universe.setSparse(opts.sparse);
+        universe.setThreads(opts.stepThreads);
+        return universe;
+    };
+
+    timeCase(opts, result, [&]() {
+        for (long long k = 0; k < numRuns; ++k) {
+            Universe universe = makeUniverse();
+            universe.run(scenario.numGens);
+        }
+        return numRuns * scenario.numGens;
+    });
+
+    Universe universe = makeUniverse();
+    countSteadyAllocations(universe, scenario.initState, scenario.numGens, result);
+    return result;
+}
+
+
+// Run universe (set up for a case, in its initial state initState) for
+// numGens generations to grow its buffers, then run it again from
+// initState, adding to result the generations of the second run and the
+// allocations made in them
+void countSteadyAllocations(Universe& universe, const std::vector<int>& initState, int numGens, Result& result)
+{
+    // the two buffers of the universe hold the worlds of alternate
+    // generations, so the second run starts from the buffer the first did
+    universe.run(numGens + numGens % 2);
+    for (int i = 0; i < universe.size(); ++i) {
+        universe.setCell(i, (i < static_cast<int>(initState.size())) ? initState[i] : 0);
+    }
+    universe.setGeneration(0);
+
+    long long before = numAllocations;
+    universe.run(numGens);
+    result.steadyAllocations += numAllocations - before;
+    result.steadyGenerations += numGens;
+}
+
+
+void printResult(std::ostream& os, const Result& result)
+{
+    double gensPerSec = result.generations / result.seconds;
+    double allocsPerGen = (result.steadyGenerations > 0)
+        ? static_cast<double>(result.steadyAllocations) / result.steadyGenerations : 0.0;
+    os << std::format("{},{},{},{:.4f},{},{:.6f},{:.1f},{:.1f},{:.3f}",
+        result.name, getNormName(result.norm), result.size, result.density, result.generations,
+        result.seconds, gensPerSec, gensPerSec * result.size, allocsPerGen) << std::endl;
+}
+
+
+std::string resultKey(const std::string& name, const std::string& norm, const std::string& size, const std::string& density)
+{
+    return std::format("{},{},{},{}", name, norm, size, density);
+}
+
+
+// Read the cells per second of each case in a baseline file, by resultKey()
+std::map<std::string, double> readBaseline(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error(std::format("Unable to open baseline file {}", filename));
+    }
+
+    std::map<std::string, double> baseline;
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(file, line)) {
+        if (++lineNum == 1 || line.empty()) {
+            continue;  // the header
+        }
+        std::vector<std::string> fields;
+        std::istringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 8) {
+            throw std::runtime_error(std::format("Malformed line {} in baseline file {}", lineNum, filename));
+        }
+        try {
+            baseline[resultKey(fields[0], fields[1], fields[2], fields[3])] = std::stod(fields[7]);
+        }
+        catch (const std::logic_error&) {
+            throw std::runtime_error(std::format("Malformed line {} in baseline file {}", lineNum, filename));
+        }
+    }
+    return baseline;
+}
+
+
+// Print a comparison of the cells per second of each result with that of the
+// same case in the baseline (read from filename), returning 2 if any has
+// regressed by more than tolerance percent (and 0 otherwise)
+int compareWithBaseline(const std::string& filename, const std::map<std::string, double>& baseline,
+                        const std::vector<Result>& results, double tolerance)
+{
+    int numCompared = 0;
+    int numRegressed = 0;
+    std::cerr << std::format("{:<40} {:>14} {:>14} {:>8}", "case", "baseline", "cells/s", "change") << std::endl;
+    for (const Result& result : results) {
+        std::string key = resultKey(result.name, getNormName(result.norm), std::to_string(result.size),
+            std::format("{:.4f}", result.density));
+        auto it = baseline.find(key);
+        if (it == baseline.end() || it->second <= 0.0) {
+            continue;
+        }
+        double cellsPerSec = result.generations * static_cast<double>(result.size) / result.seconds;
+        double change = 100.0 * (cellsPerSec - it->second) / it->second;
+        bool regressed = (change < -tolerance);
+        std::cerr << std::format("{:<40} {:>14.0f} {:>14.0f} {:>+7.1f}%{}", key, it->second, cellsPerSec,
+            change, regressed ? "  REGRESSION" : "") << std::endl;
+        ++numCompared;
+        if (regressed) {
+            ++numRegressed;
+        }
+    }
+
+    std::cerr << std::format("{} of {} cases compared with {} are more than {}% slower",
+        numRegressed, numCompared, filename, tolerance) << std::endl;
+    return (numRegressed > 0) ? 2 : 0;
+}
+
+
+Options parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    Options opts;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-p") {
+                opts.sparse = true;
+            }
+            else if (arg == "-t" && hasValue) {
+                int n = std::stoi(argv[++a]);
+                if (n < 1) {
+                    printUsageAndExit(progname, 1);
+                }
+                opts.stepThreads = static_cast<unsigned int>(n);
+            }
+            else if (arg == "-m" && hasValue) {
+                opts.maxExp = std::stoi(argv[++a]);
+                if (opts.maxExp < 2 || opts.maxExp > 8) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-d" && hasValue) {
+                opts.densities.clear();
+                std::istringstream ss(argv[++a]);
+                std::string field;
+                while (std::getline(ss, field, ',')) {
+                    double d = std::stod(field);
+                    if (d <= 0.0 || d > 1.0) {
+                        printUsageAndExit(progname, 1);
+                    }
+                    opts.densities.push_back(d);
+                }
+                if (opts.densities.empty()) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-w" && hasValue) {
+                opts.work = std::stoll(argv[++a]);
+                if (opts.work < 1) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-n" && hasValue) {
+                opts.reps = std::stoi(argv[++a]);
+                if (opts.reps < 1) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-R") {
+                opts.figureCases = false;
+            }
+            else if (arg == "-F") {
+                opts.randomCases = false;
+            }
+            else if (arg == "-b" && hasValue) {
+                opts.baselineFile = argv[++a];
+            }
+            else if (arg == "-T" && hasValue) {
+                opts.tolerance = std::stod(argv[++a]);
+                if (opts.tolerance < 0.0) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    if (!opts.randomCases && !opts.figureCases) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-p] [-t threads] [-m maxexp] [-d densities] [-w work] [-n reps] [-R|-F] [-b file [-T percent]]", progname) << std::endl;
+    std::cerr << "  where -p times sparse execution" << std::endl;
+    std::cerr << "        -t sets the number of threads used to compute each generation" << std::endl;
+    std::cerr << "        -m sets the largest random world size to 10^maxexp (2-8, default 6)" << std::endl;
+    std::cerr << "        -d sets the comma-separated densities of the random worlds" << std::endl;
+    std::cerr << "        -w sets the number of cell updates timed in each case" << std::endl;
+    std::cerr << "        -n sets the number of times each case is run (the fastest is reported)" << std::endl;
+    std::cerr << "        -R runs only the random cases, -F only the figure cases" << std::endl;
+    std::cerr << "        -b compares the results with a baseline file written by an earlier run" << std::endl;
+    std::cerr << "        -T sets the slowdown (in percent) counted as a regression (default 10)" << std::endl;
+    exit(rc);
+}
+
+
+// The global allocation functions, replaced to count the allocations
+// (pairing malloc() with free() on purpose, which GCC warns about)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size)
+{
+    ++numAllocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    ++numAllocations;
+    std::size_t a = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { operator delete(p); }
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,172 @@
+// b54capi.cpp
+//
+// Implementation of the C interface declared in b54capi.h. No exception
+// escapes it: each function catches them, records the message for
+// b54_last_error() and returns its failure value.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "b54capi.h"
+#include "scenarios.h"
+#include "universe.h"
+
+#include <algorithm>
+#include <format> // from C++20
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct b54_universe {
+    Universe universe;
+};
+
+static_assert(X_MARK == B54_X_MARK, "B54_X_MARK must match X_MARK");
+static_assert(static_cast<int>(Norm::CONDITIONAL) == B54_NORM_CONDITIONAL, "B54_NORM_* must match Norm");
+
+namespace {
+
+thread_local std::string lastError;
+
+// Call f(), returning 0, or -1 if it throws
+template <typename F>
+int guarded(F&& f)
+{
+    try {
+        f();
+        return 0;
+    }
+    catch (const std::exception& e) {
+        lastError = e.what();
+    }
+    catch (...) {
+        lastError = "Unknown error";
+    }
+    return -1;
+}
+
+void checkUniverse(const b54_universe* u)
+{
+    if (u == nullptr) {
+        throw std::invalid_argument("Universe is null");
+    }
+}
+
+// Write the current world of universe into out
+void writeState(const Universe& universe, int32_t* out)
+{
+    std::fill(out, out + universe.size(), 0);
+    universe.forEachNonBlank([out](int i, int v) { out[i] = v; });
+}
+
+} // namespace
+
+
+const char* b54_last_error(void)
+{
+    return lastError.c_str();
+}
+
+
+b54_universe* b54_create(int world_size, int norm, const int32_t* init, int init_size)
+{
+    b54_universe* u = nullptr;
+    guarded([&]() {
+        if (norm < B54_NORM_BASIC || norm > B54_NORM_CONDITIONAL) {
+            throw std::invalid_argument(std::format("Unknown norm ({})", norm));
+        }
+        if (init_size < 0 || (init_size > 0 && init == nullptr)) {
+            throw std::invalid_argument("Invalid initial state");
+        }
+        std::vector<int> initlist(init, init + init_size);
+        u = new b54_universe { Universe(world_size, static_cast<Norm>(norm), initlist) };
+    });
+    return u;
+}
+
+
+b54_universe* b54_create_scenario(int fig, unsigned int seed, int* num_gens)
+{
+    b54_universe* u = nullptr;
+    guarded([&]() {
+        Scenario scenario = makeScenario(fig, seed);
+        u = new b54_universe { Universe(scenario.worldSize, scenario.norm, scenario.initState) };
+        if (num_gens != nullptr) {
+            *num_gens = scenario.numGens;
+        }
+    });
+    return u;
+}
+
+
+void b54_destroy(b54_universe* u)
+{
+    delete u;
+}
+
+
+int b54_world_size(const b54_universe* u)
+{
+    return u ? u->universe.size() : -1;
+}
+
+
+int b54_norm(const b54_universe* u)
+{
+    return u ? static_cast<int>(u->universe.getNorm()) : -1;
+}
+
+
+long long b54_generation(const b54_universe* u)
+{
+    return u ? u->universe.getGeneration() : -1;
+}
+
+
+int b54_set_sparse(b54_universe* u, int on)
+{
+    return guarded([&]() {
+        checkUniverse(u);
+        u->universe.setSparse(on != 0);
+    });
+}
+
+
+int b54_set_threads(b54_universe* u, unsigned int num_threads)
+{
+    return guarded([&]() {
+        checkUniverse(u);
+        u->universe.setThreads(num_threads);
+    });
+}
+
+
+int b54_state(const b54_universe* u, int32_t* out)
+{
+    return guarded([&]() {
+        checkUniverse(u);
+        if (out == nullptr) {
+            throw std::invalid_argument("Output array is null");
+        }
+        writeState(u->universe, out);
+    });
+}
+
+
+int b54_run(b54_universe* u, long long num_steps, int32_t* history)
+{
+    return guarded([&]() {
+        checkUniverse(u);
+        if (num_steps < 0) {
+            throw std::invalid_argument(std::format("Number of steps ({}) must not be negative", num_steps));
+        }
+        const long long worldSize = u->universe.size();
+        for (long long k = 0; k < num_steps; ++k) {
+            u->universe.step();
+            if (history != nullptr) {
+                writeState(u->universe, history + k * worldSize);
+            }
+        }
+    });
+}
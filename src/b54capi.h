@@ -0,0 +1,79 @@
+/* b54capi.h
+ *
+ * A C interface to the simulation engine, built into the shared library
+ * libbarricelli54.so so that it can be driven from other languages (the
+ * barricelli54.py module in the base directory wraps it for Python with
+ * ctypes and NumPy).
+ *
+ * A universe is created from a world size, norm and initial state, or from
+ * the scenario of a figure, and stepped with b54_run(), which writes each
+ * generation it computes into a caller-supplied array of
+ * num_steps x world_size int32 values (one row per generation, X_MARKs as
+ * B54_X_MARK). The caller owns the array, e.g. a NumPy array, so the history
+ * is written straight into it with no copying or parsing of text.
+ *
+ * Functions returning int return 0 on success and -1 on failure; those
+ * returning a pointer return NULL on failure. The reason for the last
+ * failure on the calling thread is given by b54_last_error(). Separate
+ * universes can be used concurrently on different threads.
+ *
+ * This program is distributed under the GNU GPLv3 license. For full
+ * information, see the LICENSE file included in the base directory of
+ * this distribution.
+ */
+
+#ifndef B54CAPI_H
+#define B54CAPI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define B54_X_MARK 99999
+
+/* the norms, as numbered by Norm in universe.h */
+#define B54_NORM_BASIC 0
+#define B54_NORM_SYMBIOTIC 1
+#define B54_NORM_EXCLUSION 2
+#define B54_NORM_CONDITIONAL 3
+
+typedef struct b54_universe b54_universe;
+
+/* The reason for the last failure of a call on this thread */
+const char* b54_last_error(void);
+
+/* Create a universe of world_size cells under the given norm, whose first
+ * init_size cells are set from init (which may be NULL if init_size is 0) */
+b54_universe* b54_create(int world_size, int norm, const int32_t* init, int init_size);
+
+/* Create a universe set up as the scenario of the given figure (1-22) or
+ * test case, seeding a random initial state from seed. If num_gens is not
+ * NULL, it receives the number of generations shown in the figure. */
+b54_universe* b54_create_scenario(int fig, unsigned int seed, int* num_gens);
+
+void b54_destroy(b54_universe* u);
+
+int b54_world_size(const b54_universe* u);
+int b54_norm(const b54_universe* u);
+long long b54_generation(const b54_universe* u);
+
+/* Select sparse execution, or the number of threads used to compute each
+ * generation (see Universe::setSparse() and Universe::setThreads()) */
+int b54_set_sparse(b54_universe* u, int on);
+int b54_set_threads(b54_universe* u, unsigned int num_threads);
+
+/* Write the current world into out (world_size values) */
+int b54_state(const b54_universe* u, int32_t* out);
+
+/* Advance the universe by num_steps generations. If history is not NULL,
+ * row k of it (world_size values from history + k * world_size) receives
+ * the world after step k + 1. */
+int b54_run(b54_universe* u, long long num_steps, int32_t* history);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* B54CAPI_H */
@@ -0,0 +1,172 @@
+// b54check
+//
+// Checks each of the engine's ways of computing a generation against an
+// independent naive reference (see check.h), on the scenarios of the figures and on
+// random worlds of every norm, in parallel on all cores. The first case on
+// which an engine diverges from the reference is reported with the first
+// generation and cell that differ, and the command that reruns just that
+// case; the program then exits with status 1. Otherwise a summary of the
+// check is written.
+//
+// Usage:
+//   > b54check [-e engines] [-x] [-n cases] [-k first] [-w size] [-g gens] [-s seed] [-j threads]
+//   > b54check -l
+// where:
+//   -e Comma separated list of the engines to check (default: all those
+//      checked by default); run with -l for the list
+//   -x Skip the figures, checking just the random worlds
+//   -n Number of random worlds ("fuzz cases") to check (default: 10000)
+//   -k Number of the first fuzz case (default: 0)
+//   -w Size of the largest fuzz world (default: 2000)
+//   -g Largest number of generations a fuzz world is run for (default: 50)
+//   -s Seed of the fuzz cases, and of the figures with a random initial
+//      state (default: 0). Fuzz case k is drawn from the seed and k
+//   -j Number of worker threads (default: one per core)
+//   -l List the engines and exit
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <format> // from C++20
+#include <chrono>
+#include <stdexcept>
+
+#include "check.h"
+#include "universe.h"
+
+void printUsageAndExit(const std::string& progname, int rc);
+CheckOptions parseOptionsOrExit(int argc, char** argv);
+std::string formatValue(int v);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    CheckOptions opts = parseOptionsOrExit(argc, argv);
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        CheckResult result = check(opts);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (result.divergence) {
+            const Divergence& d = *result.divergence;
+            if (d.cell < 0) {
+                std::cout << std::format("Engine {} stopped short of the reference on {} at generation {}",
+                    d.engine, d.checkCase.name, d.generation) << std::endl;
+            }
+            else {
+                std::cout << std::format("Engine {} diverged from the reference on {} at generation {}, cell {}: {} instead of {}",
+                    d.engine, d.checkCase.name, d.generation, d.cell, formatValue(d.got), formatValue(d.expected)) << std::endl;
+            }
+            std::string rerun = std::format("b54check -e {} -s {}", d.engine, opts.fuzz.seed);
+            if (d.checkCase.fuzzCase >= 0) {
+                rerun += std::format(" -x -k {} -n 1 -w {} -g {}", d.checkCase.fuzzCase, opts.fuzz.maxWorldSize, opts.fuzz.maxSteps);
+            }
+            else {
+                rerun += " -n 0";
+            }
+            std::cout << std::format("Rerun with: {}", rerun) << std::endl;
+            exit(1);
+        }
+
+        std::cout << std::format("{} cases, {} generations checked in {:.2f}s ({:.0f} per second): no divergence",
+            result.numCases, result.numGenerations, seconds, (seconds > 0.0) ? result.numGenerations / seconds : 0.0) << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+// A cell value as printed in a report (X for an X_MARK)
+std::string formatValue(int v)
+{
+    return (v == X_MARK) ? "X" : std::to_string(v);
+}
+
+
+CheckOptions parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    CheckOptions opts;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-l") {
+                for (const Engine& e : getEngines()) {
+                    std::cout << std::format("{:<16} {}", e.name, e.description) << std::endl;
+                }
+                exit(0);
+            }
+            else if (arg == "-e" && hasValue) {
+                std::istringstream names { argv[++a] };
+                std::string name;
+                while (std::getline(names, name, ',')) {
+                    getEngine(name);
+                    opts.engines.push_back(name);
+                }
+            }
+            else if (arg == "-x") {
+                opts.figures = false;
+            }
+            else if (arg == "-n" && hasValue) {
+                opts.numCases = std::stoll(argv[++a]);
+            }
+            else if (arg == "-k" && hasValue) {
+                opts.firstCase = std::stoll(argv[++a]);
+            }
+            else if (arg == "-w" && hasValue) {
+                opts.fuzz.maxWorldSize = std::stoi(argv[++a]);
+            }
+            else if (arg == "-g" && hasValue) {
+                opts.fuzz.maxSteps = std::stoi(argv[++a]);
+            }
+            else if (arg == "-s" && hasValue) {
+                opts.fuzz.seed = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else if (arg == "-j" && hasValue) {
+                opts.numThreads = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-e engines] [-x] [-n cases] [-k first] [-w size] [-g gens] [-s seed] [-j threads]", progname) << std::endl;
+    std::cerr << std::format("       {} -l", progname) << std::endl;
+    std::cerr << "        -e sets the comma separated engines to check (default: those listed by -l as checked by default)" << std::endl;
+    std::cerr << "        -x skips the figures, checking just the random worlds" << std::endl;
+    std::cerr << "        -n sets the number of random worlds (fuzz cases) to check (default: 10000)" << std::endl;
+    std::cerr << "        -k sets the number of the first fuzz case (default: 0)" << std::endl;
+    std::cerr << "        -w sets the size of the largest fuzz world (default: 2000)" << std::endl;
+    std::cerr << "        -g sets the largest number of generations of a fuzz world (default: 50)" << std::endl;
+    std::cerr << "        -s sets the seed of the fuzz cases and random figures (default: 0)" << std::endl;
+    std::cerr << "        -j sets the number of worker threads (default: one per core)" << std::endl;
+    std::cerr << "        -l lists the engines" << std::endl;
+    exit(rc);
+}
@@ -0,0 +1,182 @@
+// b54dist
+//
+// Runs a figure or test case of barricelli54 with its world split between
+// several processes (ranks) on the local machine, each computing the
+// generations of its own shard of the world (see distributed.h). The output
+// is the same as that of barricelli54, so the two can be compared directly.
+// The world of the scenario can be enlarged, and its run lengthened, to try
+// out universes much larger than those of the paper.
+//
+// Usage:
+//   > b54dist [-c] [-q] [-n ranks] [-w size] [-g gens] [-s seed] n
+// where:
+//   n  is a number between 1 and 25 to specify the figure or test case
+//   -c Produce output in CSV format rather than space separated
+//   -q Produce no output, just a summary of the run on standard error
+//   -n Number of ranks the world is split between (default: 2)
+//   -w Run the scenario's initial state in a world of the given size
+//      (default: the scenario's own)
+//   -g Number of generations to run, including the first (default: the
+//      scenario's own)
+//   -s Seed for scenarios with a random initial state (e.g. test case 25).
+//      If not specified, a seed is drawn from std::random_device
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <format> // from C++20
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+#include "distributed.h"
+#include "scenarios.h"
+#include "universe.h"
+
+struct Options {
+    int fig = 0;
+    unsigned int seed = 0;
+    bool seedGiven = false;
+    int numRanks = 2;
+    int worldSize = 0;      // 0 => the scenario's own
+    int numGens = 0;        // 0 => the scenario's own
+    bool csv = false;
+    bool quiet = false;
+};
+
+void printUsageAndExit(const std::string& progname, int rc);
+Options parseOptionsOrExit(int argc, char** argv);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    Options opts = parseOptionsOrExit(argc, argv);
+
+    if (!opts.seedGiven) {
+        std::random_device rnd_device;
+        opts.seed = rnd_device();
+    }
+
+    try {
+        Scenario scenario = makeScenario(opts.fig, opts.seed);
+        if (opts.worldSize > 0) {
+            scenario.worldSize = opts.worldSize;
+        }
+        if (opts.numGens > 0) {
+            scenario.numGens = opts.numGens;
+        }
+
+        if (scenario.initState.size() > static_cast<std::size_t>(scenario.worldSize)) {
+            throw std::invalid_argument(std::format("World size ({}) is smaller than the initial state ({})",
+                scenario.worldSize, scenario.initState.size()));
+        }
+        std::vector<int> state = scenario.initState;
+        state.resize(scenario.worldSize, 0);
+        if (!opts.quiet) {
+            if (!opts.csv) {
+                std::cout << getScenarioTitle(scenario) << std::endl << std::endl;
+            }
+            printWorld(std::cout, state, opts.csv);
+        }
+        // the ranks are forked from this process, so nothing may be left in its buffers
+        std::cout.flush();
+
+        auto start = std::chrono::steady_clock::now();
+        runDistributed(scenario.worldSize, scenario.norm, scenario.initState, scenario.numGens - 1, opts.numRanks,
+            [&](std::span<const std::int32_t> world) {
+                if (!opts.quiet) {
+                    state.assign(world.begin(), world.end());
+                    printWorld(std::cout, state, opts.csv);
+                }
+            });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!opts.quiet && !opts.csv) {
+            std::cout << std::endl;
+        }
+        if (opts.quiet) {
+            std::cerr << std::format("{} generations of {} cells on {} ranks in {:.2f}s",
+                scenario.numGens, scenario.worldSize, opts.numRanks, seconds) << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+Options parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    Options opts;
+    bool figGiven = false;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-c") {
+                opts.csv = true;
+            }
+            else if (arg == "-q") {
+                opts.quiet = true;
+            }
+            else if (arg == "-n" && hasValue) {
+                opts.numRanks = std::stoi(argv[++a]);
+            }
+            else if (arg == "-w" && hasValue) {
+                opts.worldSize = std::stoi(argv[++a]);
+            }
+            else if (arg == "-g" && hasValue) {
+                opts.numGens = std::stoi(argv[++a]);
+            }
+            else if (arg == "-s" && hasValue) {
+                opts.seed = static_cast<unsigned int>(std::stoul(argv[++a]));
+                opts.seedGiven = true;
+            }
+            else if (!figGiven && !arg.empty() && arg[0] != '-') {
+                opts.fig = std::stoi(arg);
+                figGiven = true;
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    if (!figGiven || opts.fig < 1 || opts.fig > NUM_RULES || opts.numRanks < 1 || opts.worldSize < 0 || opts.numGens < 0) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-c] [-q] [-n ranks] [-w size] [-g gens] [-s seed] n", progname) << std::endl;
+    std::cerr << std::format("        n is the figure (1-22) or test case (23-{}) to run", NUM_RULES) << std::endl;
+    std::cerr << "        -c specifies that output should be in CSV format" << std::endl;
+    std::cerr << "        -q produces no output but a summary of the run on standard error" << std::endl;
+    std::cerr << "        -n sets the number of ranks (processes) the world is split between (default: 2)" << std::endl;
+    std::cerr << "        -w sets the world size (default: the scenario's own)" << std::endl;
+    std::cerr << "        -g sets the number of generations (default: the scenario's own)" << std::endl;
+    std::cerr << "        -s sets the seed for scenarios with a random initial state" << std::endl;
+    exit(rc);
+}
@@ -0,0 +1,221 @@
+// b54islands
+//
+// Runs an island model (see islands.h): a number of universes, each on a
+// thread of its own, that swap the segments of cells at their boundaries
+// with their neighbours every k generations. Each island starts from a
+// random initial state drawn from the seed and its number, so a run depends
+// only on its options. A summary of the final state of each island is
+// written to standard output as CSV, one line per island: its number, the
+// numbers and X_MARKs in its world, and a hash of the world (see
+// Universe::stateHash()). With -o, the run of each island is written to a
+// file of its own in the CSV output format of barricelli54.
+//
+// Usage:
+//   > b54islands [-N norm] [-n islands] [-w size] [-g gens] [-k interval] [-L length] [-T topology] [-l length] [-m max] [-d density] [-s seed] [-p] [-o prefix]
+// where:
+//   -N Norm of the islands: basic, symbiotic (default), exclusion or conditional
+//   -n Number of islands (default: 8)
+//   -w World size of each island (default: 1000)
+//   -g Generations each island is run for (default: 1000)
+//   -k Generations between migrations (default: 50)
+//   -L Length of the boundary segments swapped at a migration (default: 20)
+//   -T Topology of the islands: ring (default) or line
+//   -l Number of cells at the start of each island given random values
+//      (default: all of them)
+//   -m Magnitude of the largest number in an initial state (default: 10)
+//   -d Chance of each of those cells holding a number (default: 0.5)
+//   -s Seed of the initial states (default: 0)
+//   -p Sparse execution of each island (the results are the same)
+//   -o Write the run of island i to <prefix>-<i>.csv
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <format> // from C++20
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#include "islands.h"
+#include "universe.h"
+
+struct Options {
+    IslandOptions islands;
+    std::string outPrefix;
+};
+
+void printUsageAndExit(const std::string& progname, int rc);
+Options parseOptionsOrExit(int argc, char** argv);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    Options opts = parseOptionsOrExit(argc, argv);
+
+    try {
+        // each island writes its run to its own file, on its own thread
+        std::vector<std::unique_ptr<std::ofstream>> files;
+        IslandCallback onGeneration;
+        if (!opts.outPrefix.empty()) {
+            for (int i = 0; i < opts.islands.numIslands; ++i) {
+                std::string filename = std::format("{}-{}.csv", opts.outPrefix, i);
+                files.push_back(std::make_unique<std::ofstream>(filename));
+                if (!*files.back()) {
+                    throw std::runtime_error(std::format("Unable to open output file {}", filename));
+                }
+            }
+            onGeneration = [&files](int island, const Universe& universe) {
+                printWorld(*files[island], universe, true);
+            };
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<int>> finalStates = runIslands(opts.islands, onGeneration);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::string out = "island,numbers,x_marks,hash\n";
+        for (std::size_t i = 0; i < finalStates.size(); ++i) {
+            Universe universe(opts.islands.worldSize, opts.islands.norm, finalStates[i]);
+            long long numbers = 0;
+            long long xMarks = 0;
+            universe.forEachNonBlank([&](int, int v) {
+                if (v == X_MARK) {
+                    ++xMarks;
+                }
+                else {
+                    ++numbers;
+                }
+            });
+            out += std::format("{},{},{},{:016x}\n", i, numbers, xMarks, universe.stateHash());
+        }
+        std::cout << out;
+
+        long long numGens = static_cast<long long>(opts.islands.numIslands) * opts.islands.numGens;
+        std::cerr << std::format("{} islands of {} cells, {} generations each, in {:.2f}s ({:.0f} generations per second)",
+            opts.islands.numIslands, opts.islands.worldSize, opts.islands.numGens, seconds,
+            (seconds > 0.0) ? numGens / seconds : 0.0) << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+Options parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    Options opts;
+    IslandOptions& isl = opts.islands;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-N" && hasValue) {
+                std::string name { argv[++a] };
+                if (name == "basic") {
+                    isl.norm = Norm::BASIC;
+                }
+                else if (name == "symbiotic") {
+                    isl.norm = Norm::SYMBIOTIC;
+                }
+                else if (name == "exclusion") {
+                    isl.norm = Norm::EXCLUSION;
+                }
+                else if (name == "conditional") {
+                    isl.norm = Norm::CONDITIONAL;
+                }
+                else {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-n" && hasValue) {
+                isl.numIslands = std::stoi(argv[++a]);
+            }
+            else if (arg == "-w" && hasValue) {
+                isl.worldSize = std::stoi(argv[++a]);
+            }
+            else if (arg == "-g" && hasValue) {
+                isl.numGens = std::stoi(argv[++a]);
+            }
+            else if (arg == "-k" && hasValue) {
+                isl.migrationInterval = std::stoi(argv[++a]);
+            }
+            else if (arg == "-L" && hasValue) {
+                isl.segmentLength = std::stoi(argv[++a]);
+            }
+            else if (arg == "-T" && hasValue) {
+                std::string name { argv[++a] };
+                if (name == "ring") {
+                    isl.topology = Topology::RING;
+                }
+                else if (name == "line") {
+                    isl.topology = Topology::LINE;
+                }
+                else {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-l" && hasValue) {
+                isl.initLength = std::stoi(argv[++a]);
+            }
+            else if (arg == "-m" && hasValue) {
+                isl.maxValue = std::stoi(argv[++a]);
+            }
+            else if (arg == "-d" && hasValue) {
+                isl.density = std::stod(argv[++a]);
+            }
+            else if (arg == "-s" && hasValue) {
+                isl.seed = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else if (arg == "-p") {
+                isl.sparse = true;
+            }
+            else if (arg == "-o" && hasValue) {
+                opts.outPrefix = argv[++a];
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-N norm] [-n islands] [-w size] [-g gens] [-k interval] [-L length] [-T topology] [-l length] [-m max] [-d density] [-s seed] [-p] [-o prefix]", progname) << std::endl;
+    std::cerr << "        -N sets the norm: basic, symbiotic (default), exclusion or conditional" << std::endl;
+    std::cerr << "        -n sets the number of islands (default: 8)" << std::endl;
+    std::cerr << "        -w sets the world size of each island (default: 1000)" << std::endl;
+    std::cerr << "        -g sets the generations each island is run for (default: 1000)" << std::endl;
+    std::cerr << "        -k sets the generations between migrations (default: 50)" << std::endl;
+    std::cerr << "        -L sets the length of the boundary segments swapped at a migration (default: 20)" << std::endl;
+    std::cerr << "        -T sets the topology of the islands: ring (default) or line" << std::endl;
+    std::cerr << "        -l sets the number of cells given random initial values (default: all)" << std::endl;
+    std::cerr << "        -m sets the largest magnitude of an initial number (default: 10)" << std::endl;
+    std::cerr << "        -d sets the chance of each of those cells holding a number (default: 0.5)" << std::endl;
+    std::cerr << "        -s sets the seed of the initial states (default: 0)" << std::endl;
+    std::cerr << "        -p specifies sparse execution of each island" << std::endl;
+    std::cerr << "        -o writes the run of island i to <prefix>-<i>.csv" << std::endl;
+    exit(rc);
+}
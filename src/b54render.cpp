@@ -0,0 +1,244 @@
+// b54render
+//
+// Renders the output of barricelli54 as images in the style of the figures
+// of Barricelli's 1954 paper (see render.h), replacing the csv2img.py
+// script. Each input is either a CSV file written by "barricelli54 -c" or a
+// binary trace written by "barricelli54 -b", and is written to an image of
+// the same basename (e.g. fig8.csv to fig8.png). Several inputs are
+// rendered in parallel.
+//
+// Usage:
+//   > b54render [-b] [-P] [-s pixels] [-g first[:last]] [-j threads] [-d dir] file... [label_specs...]
+// where:
+//   file  is a CSV file or binary trace written by barricelli54
+//   label_specs  are of the form <above|below>:<start_col>:<end_col>:<label_text>,
+//      and draw a bracket from the left edge of column start_col to that of
+//      column end_col, above the first row or below the last one, with the
+//      label text next to it (the same labels are drawn on every image)
+//   -b Draw grid lines around the cells
+//   -P Write PPM images rather than PNG
+//   -s Size of each cell in pixels (default: 36, about the size of the cells
+//      drawn by csv2img.py). Below 8 pixels the numbers are not written, and
+//      occupied cells are filled instead
+//   -g Render only generations first to last inclusive (counting from 0;
+//      last defaults to the final generation)
+//   -j Number of images rendered at once (default: one per core)
+//   -d Write the images to the given directory (default: the working directory)
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <format> // from C++20
+#include <stdexcept>
+#include <filesystem>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "render.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "universe.h"
+
+struct Options {
+    std::vector<std::string> filenames;
+    RenderOptions render;
+    bool ppm = false;
+    long long first = 0;
+    long long last = -1;    // -1 => the final generation
+    unsigned int numThreads = 0;
+    std::string outDir = ".";
+};
+
+void printUsageAndExit(const std::string& progname, int rc);
+Options parseOptionsOrExit(int argc, char** argv);
+std::vector<std::vector<int>> readWorlds(const std::string& filename, long long first, long long last);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    Options opts = parseOptionsOrExit(argc, argv);
+
+    std::mutex outputMutex;
+    std::atomic<bool> failed { false };
+    {
+        WorkStealingPool pool(opts.numThreads);
+        for (const std::string& filename : opts.filenames) {
+            pool.submit([&]() {
+                try {
+                    std::filesystem::path out = std::filesystem::path(opts.outDir) /
+                        std::filesystem::path(filename).stem().concat(opts.ppm ? ".ppm" : ".png");
+                    Image image = renderWorlds(readWorlds(filename, opts.first, opts.last), opts.render);
+                    saveImage(out.string(), image);
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cout << std::format("Image saved as {}", out.string()) << std::endl;
+                }
+                catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cerr << std::format("Error: {}: {}!", filename, e.what()) << std::endl;
+                    failed = true;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    return failed ? 1 : 0;
+}
+
+
+// Read generations first to last (inclusive, or to the end if last is -1)
+// of a CSV file or binary trace written by barricelli54. Throws
+// std::runtime_error if the file cannot be read.
+std::vector<std::vector<int>> readWorlds(const std::string& filename, long long first, long long last)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file || std::filesystem::is_directory(filename)) {
+        throw std::runtime_error(std::format("Unable to open input file {}", filename));
+    }
+    char magic[8] = {};
+    file.read(magic, sizeof(magic));
+    std::vector<std::vector<int>> worlds;
+
+    if (file && std::string(magic, sizeof(magic)) == "B54TRACE") {
+        file.close();
+        TraceReader trace(filename);
+        long long end = (last < 0) ? trace.getNumGenerations() : std::min(last + 1, trace.getNumGenerations());
+        if (first < end) {
+            trace.forEachGeneration(first, end, [&](long long, const std::vector<int>& state) {
+                worlds.push_back(state);
+            });
+        }
+        return worlds;
+    }
+
+    // a CSV file, one generation per line, with "x" for an X_MARK (anything
+    // else that is not a number is taken to be blank, as by csv2img.py)
+    file.clear();
+    file.seekg(0);
+    std::string line;
+    long long g = 0;
+    while ((last < 0 || g <= last) && std::getline(file, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        if (g++ < first) {
+            continue;
+        }
+        std::vector<int>& world = worlds.emplace_back();
+        std::size_t pos = 0;
+        while (pos <= line.size()) {
+            std::size_t comma = std::min(line.find(',', pos), line.size());
+            std::string item = line.substr(pos, comma - pos);
+            item.erase(0, item.find_first_not_of(" \t\r"));
+            item.erase(item.find_last_not_of(" \t\r") + 1);
+            if (item == "x" || item == "X") {
+                world.push_back(X_MARK);
+            }
+            else {
+                try {
+                    world.push_back(std::stoi(item));
+                }
+                catch (const std::exception&) {
+                    world.push_back(0);
+                }
+            }
+            pos = comma + 1;
+        }
+    }
+    return worlds;
+}
+
+
+Options parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    Options opts;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-b") {
+                opts.render.grid = true;
+            }
+            else if (arg == "-P") {
+                opts.ppm = true;
+            }
+            else if (arg == "-s" && hasValue) {
+                opts.render.cellSize = std::stoi(argv[++a]);
+                if (opts.render.cellSize < 1) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-g" && hasValue) {
+                std::string range { argv[++a] };
+                std::size_t colon = range.find(':');
+                opts.first = std::stoll(range.substr(0, colon));
+                if (colon != std::string::npos) {
+                    opts.last = std::stoll(range.substr(colon+1));
+                    if (opts.last < opts.first) {
+                        printUsageAndExit(progname, 1);
+                    }
+                }
+                if (opts.first < 0) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-j" && hasValue) {
+                opts.numThreads = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else if (arg == "-d" && hasValue) {
+                opts.outDir = argv[++a];
+            }
+            else if (arg.starts_with("above:") || arg.starts_with("below:")) {
+                opts.render.labels.push_back(parseBracketLabel(arg));
+            }
+            else if (!arg.empty() && arg[0] != '-') {
+                opts.filenames.push_back(arg);
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        printUsageAndExit(progname, 1);
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    if (opts.filenames.empty()) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-b] [-P] [-s pixels] [-g first[:last]] [-j threads] [-d dir] file... [label_specs...]", progname) << std::endl;
+    std::cerr << "  where each file is a CSV file or binary trace written by barricelli54" << std::endl;
+    std::cerr << "        label_specs format: above|below:<start_col>:<end_col>:<label_text>" << std::endl;
+    std::cerr << "        -b draws grid lines around the cells" << std::endl;
+    std::cerr << "        -P writes PPM rather than PNG images" << std::endl;
+    std::cerr << "        -s sets the size of each cell in pixels (default: 36)" << std::endl;
+    std::cerr << "        -g renders only generations first to last (counting from 0)" << std::endl;
+    std::cerr << "        -j sets the number of images rendered at once (default: one per core)" << std::endl;
+    std::cerr << "        -d writes the images to dir (default: the working directory)" << std::endl;
+    exit(rc);
+}
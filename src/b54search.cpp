@@ -0,0 +1,182 @@
+// b54search
+//
+// Searches random initial configurations for ones that give rise to
+// persistent or diverse symbioorganisms (see search.h), in parallel on all
+// cores. Candidates that go extinct or stop changing are pruned as soon as
+// they do, and the best of the survivors are written to standard output as
+// CSV, one line per candidate: its rank, candidate number, fitness and
+// initial state (space separated). A summary of the search is written to
+// standard error.
+//
+// Usage:
+//   > b54search [-N norm] [-w size] [-g gens] [-l length] [-m max] [-d density] [-n candidates] [-F fitness] [-k best] [-s seed] [-j threads]
+//   > b54search -h
+// where:
+//   -N Norm of the candidates: basic, symbiotic (default), exclusion or conditional
+//   -w World size (default: 100)
+//   -g Generations each candidate is run for (default: 200)
+//   -l Number of cells at the start of the world given random values (default: 20)
+//   -m Magnitude of the largest number in an initial state (default: 10)
+//   -d Chance of each of those cells holding a number (default: 0.5)
+//   -n Number of candidates (default: 10000)
+//   -F Fitness function by which survivors are ranked (default: persistence);
+//      run with -h for the list
+//   -k Number of the best candidates written (default: 20)
+//   -s Seed of the search. Candidate k is drawn from the seed and k, so the
+//      results are the same for any number of threads
+//   -j Number of worker threads (default: one per core)
+//   -h Print the usage message, with the list of fitness functions
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <iostream>
+#include <string>
+#include <format> // from C++20
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+
+#include "search.h"
+#include "universe.h"
+
+void printUsageAndExit(const std::string& progname, int rc);
+SearchOptions parseOptionsOrExit(int argc, char** argv);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    SearchOptions opts = parseOptionsOrExit(argc, argv);
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = search(opts);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::string out = "rank,candidate,fitness,init_state\n";
+        for (std::size_t r = 0; r < result.best.size(); ++r) {
+            const Candidate& c = result.best[r];
+            std::format_to(std::back_inserter(out), "{},{},{},", r + 1, c.index, c.fitness);
+            for (std::size_t i = 0; i < c.initState.size(); ++i) {
+                if (i > 0) {
+                    out += ' ';
+                }
+                out += std::to_string(c.initState[i]);
+            }
+            out += '\n';
+        }
+        std::cout << out;
+
+        std::cerr << std::format("{} candidates in {:.2f}s ({:.0f} per hour): {} extinct, {} static, {} survivors; {} generations",
+            opts.numCandidates, seconds, (seconds > 0.0) ? 3600.0 * opts.numCandidates / seconds : 0.0,
+            result.numExtinct, result.numStatic, result.numSurvivors, result.numGenerations) << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+SearchOptions parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    SearchOptions opts;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-h") {
+                printUsageAndExit(progname, 0);
+            }
+            else if (arg == "-N" && hasValue) {
+                std::string name { argv[++a] };
+                if (name == "basic") {
+                    opts.norm = Norm::BASIC;
+                }
+                else if (name == "symbiotic") {
+                    opts.norm = Norm::SYMBIOTIC;
+                }
+                else if (name == "exclusion") {
+                    opts.norm = Norm::EXCLUSION;
+                }
+                else if (name == "conditional") {
+                    opts.norm = Norm::CONDITIONAL;
+                }
+                else {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-w" && hasValue) {
+                opts.worldSize = std::stoi(argv[++a]);
+            }
+            else if (arg == "-g" && hasValue) {
+                opts.numGens = std::stoi(argv[++a]);
+            }
+            else if (arg == "-l" && hasValue) {
+                opts.initLength = std::stoi(argv[++a]);
+            }
+            else if (arg == "-m" && hasValue) {
+                opts.maxValue = std::stoi(argv[++a]);
+            }
+            else if (arg == "-d" && hasValue) {
+                opts.density = std::stod(argv[++a]);
+            }
+            else if (arg == "-n" && hasValue) {
+                opts.numCandidates = std::stoll(argv[++a]);
+            }
+            else if (arg == "-F" && hasValue) {
+                opts.fitness = getFitness(argv[++a]);
+            }
+            else if (arg == "-k" && hasValue) {
+                opts.numBest = std::stoi(argv[++a]);
+            }
+            else if (arg == "-s" && hasValue) {
+                opts.seed = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else if (arg == "-j" && hasValue) {
+                opts.numThreads = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-N norm] [-w size] [-g gens] [-l length] [-m max] [-d density] [-n candidates] [-F fitness] [-k best] [-s seed] [-j threads]", progname) << std::endl;
+    std::cerr << std::format("       {} -h", progname) << std::endl;
+    std::cerr << "        -N sets the norm: basic, symbiotic (default), exclusion or conditional" << std::endl;
+    std::cerr << "        -w sets the world size (default: 100)" << std::endl;
+    std::cerr << "        -g sets the generations each candidate is run for (default: 200)" << std::endl;
+    std::cerr << "        -l sets the number of cells given random initial values (default: 20)" << std::endl;
+    std::cerr << "        -m sets the largest magnitude of an initial number (default: 10)" << std::endl;
+    std::cerr << "        -d sets the chance of each of those cells holding a number (default: 0.5)" << std::endl;
+    std::cerr << "        -n sets the number of candidates (default: 10000)" << std::endl;
+    std::cerr << "        -F sets the fitness function ranking the survivors (default: persistence):" << std::endl;
+    for (const NamedFitness& f : getFitnessFunctions()) {
+        std::cerr << std::format("             {:<12} {}", f.name, f.description) << std::endl;
+    }
+    std::cerr << "        -k sets the number of the best candidates written (default: 20)" << std::endl;
+    std::cerr << "        -s sets the seed of the search" << std::endl;
+    std::cerr << "        -j sets the number of worker threads (default: one per core)" << std::endl;
+    exit(rc);
+}
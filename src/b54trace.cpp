@@ -0,0 +1,140 @@
+// b54trace
+//
+// Converts a binary trace written by "barricelli54 -b" (see trace.h) into the
+// CSV or padded text output that barricelli54 would have printed for the
+// same run.
+//
+// Usage:
+//   > b54trace [-c] [-g first[:last]] tracefile
+// where:
+//   tracefile  is a trace written by barricelli54 -b
+//   -c Produce output in CSV format. If this flag is not specified, the
+//      output is space separated and padded so that columns line up
+//      vertically, preceded by the same description of the run as
+//      barricelli54 prints
+//   -g Output only generations first to last inclusive (counting from 0;
+//      last defaults to the final generation). The trace's index means
+//      only the generations from the keyframe before first onwards are
+//      decoded
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+
+#include <iostream>
+#include <string>
+#include <format> // from C++20
+#include <stdexcept>
+
+#include "scenarios.h"
+#include "trace.h"
+#include "universe.h"
+
+struct Options {
+    std::string filename;
+    bool csv = false;
+    long long first = 0;
+    long long last = -1;    // -1 => the final generation
+};
+
+void printUsageAndExit(const std::string& progname, int rc);
+Options parseOptionsOrExit(int argc, char** argv);
+
+/********************************************************** */
+
+int main(int argc, char** argv)
+{
+    Options opts = parseOptionsOrExit(argc, argv);
+
+    try {
+        TraceReader trace(opts.filename);
+        const TraceHeader& header = trace.getHeader();
+        long long last = (opts.last < 0) ? trace.getNumGenerations() - 1 : opts.last;
+
+        if (!opts.csv) {
+            Scenario scenario;
+            scenario.fig = header.fig;
+            scenario.worldSize = header.worldSize;
+            scenario.numGens = header.numGens;
+            scenario.norm = header.norm;
+            scenario.randomInit = header.randomInit;
+            scenario.seed = header.seed;
+            std::cout << getScenarioTitle(scenario) << std::endl << std::endl;
+        }
+
+        trace.forEachGeneration(opts.first, last + 1, [&](long long, const std::vector<int>& state) {
+            printWorld(std::cout, state, opts.csv);
+        });
+
+        if (!opts.csv) {
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+Options parseOptionsOrExit(int argc, char** argv)
+{
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
+    }
+
+    Options opts;
+
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-c") {
+                opts.csv = true;
+            }
+            else if (arg == "-g" && hasValue) {
+                std::string range { argv[++a] };
+                std::size_t colon = range.find(':');
+                opts.first = std::stoll(range.substr(0, colon));
+                if (colon != std::string::npos) {
+                    opts.last = std::stoll(range.substr(colon+1));
+                    if (opts.last < opts.first) {
+                        printUsageAndExit(progname, 1);
+                    }
+                }
+                if (opts.first < 0) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (opts.filename.empty() && !arg.empty() && arg[0] != '-') {
+                opts.filename = arg;
+            }
+            else {
+                printUsageAndExit(progname, 1);
+            }
+        }
+    }
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
+
+    if (opts.filename.empty()) {
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-c] [-g first[:last]] tracefile", progname) << std::endl;
+    std::cerr << "  where tracefile is a binary trace written by barricelli54 -b" << std::endl;
+    std::cerr << "        -c specifies CSV output" << std::endl;
+    std::cerr << "        -g outputs only generations first to last (counting from 0)" << std::endl;
+    exit(rc);
+}
@@ -23,16 +23,75 @@
 // and reproduces the corresponding figure from Barricelli's 1954 paper.
 //
 // Usage:
-//   > barricelli54 [-c] n
+//   > barricelli54 [-c|-b|-S|-P] [-p] [-f] [-I] [-t threads] [-C file] [-k file [-K gens]] [-d every] [-u] [-s seed] [-e runs [-j threads] [-o prefix]] n
+//   > barricelli54 [-c|-S] [-p] [-f] [-I] [-t threads] [-C file] [-k file [-K gens]] [-d every] [-u] -r file
 // where:
 //   n  is a number between 1 and 22 to specify which figure from
 //      Barricelli's 1954 paper is to be reproduced
 //   -c Produce output in CSV format. If this flag is not specified, the
 //      output is space separated and padded so that columns line up
 //      vertically
+//   -b Produce output as a binary trace (see trace.h) rather than text. The
+//      b54trace program converts a trace to the CSV or text output
+//   -P Produce output as a PNG image of the run in the style of the figures
+//      of the paper (see render.h) rather than text. The b54render program
+//      renders the CSV output or a binary trace with grid lines and labels
+//   -S Produce a CSV time series of statistics of each generation (see
+//      stats.h: population, density, X_MARK count, numbers of positive and
+//      negative numbers, mutations, and a histogram of the numbers from -16
+//      to 16) rather than the world itself
+//   -p Sparse execution: each generation visits only the occupied cells of
+//      the world rather than every cell. The output is the same, but runs
+//      on large, mostly blank universes are much faster
+//   -f Fast-forward: detect when the world goes blank, stops changing or
+//      starts repeating itself, and produce the rest of the output from the
+//      recorded states of the cycle rather than by simulating it (or, if the
+//      cycle is too large to record, by computing only the generations that
+//      are written or checkpointed). The output is the same
+//   -I Instrument the run, and print a report of the instrumentation counters
+//      (see counters.h) to standard error at the end of it (totalled over the
+//      replicates of an ensemble). The output is the same
+//   -t Number of threads used to compute each generation of the universe
+//      (default: 1). The output is the same for any number of threads
+//   -C Write a census of the species of organisms seen during the run (see
+//      census.h) to the given file as CSV. For an ensemble, the census of
+//      replicate k is written to <file>-<k>.csv
+//   -k Write a checkpoint of the run to the given file every 1000 generations
+//      (or every -K generations), from which it can be resumed with -r. The
+//      checkpoints are written on a background thread, each to a temporary
+//      file renamed over the last, so the file always holds a whole checkpoint.
+//      The output is flushed at each checkpoint
+//   -r Resume the run checkpointed in the given file (the figure number is
+//      taken from the checkpoint). The output carries on from the line of the
+//      checkpointed generation: appended to the output of the interrupted
+//      run up to that line, it is the same as that of an uninterrupted run
+//      (with -u, the checkpoint records the last row written, which need not
+//      be that of the checkpointed generation)
+//   -d Decimate the text or CSV output of the world, writing only the
+//      generations whose number is a multiple of the given one
+//   -u Write only the generations whose world differs from the last one
+//      written (with -d, of those that are a multiple of its number). The
+//      text and CSV output of the world is written on a background thread
+//      (see world_writer.h) in any case, so the run is not held up by it
+//   -s Seed for the random number generator used by scenarios with a random
+//      initial state (e.g. test case 25). If not specified, a seed is drawn
+//      from std::random_device
+//   -e Run an ensemble of the given number of replicates of the scenario in
+//      parallel. Replicate k (counting from 0) is seeded with seed+k, so any
+//      replicate can be rerun on its own with "-s <seed+k>"
+//   -j Number of worker threads for an ensemble (default: one per core)
+//   -o Write each replicate of an ensemble to its own file <prefix>-<k>.csv
+//      (or .txt without -c or -S, .b54 with -b, or .png with -P), and the seed of each replicate to
+//      <prefix>-seeds.csv. Without -o, all replicates are written in order
+//      to standard output, each preceded by a line giving its run number
+//      and seed (binary traces and images of an ensemble must be written to files)
+//
+// The simulation engine itself (universe.h) and the figure configurations
+// (scenarios.h) are built as the library libbarricelli54.a, which this
+// program links against. See the compile script in the base directory.
 //
 // Example compilation command with the g++ compiler:
-//   > g++ -std=c++20 -o barricelli54 barricelli54.cpp
+//   > g++ -std=c++20 -pthread -o barricelli54 barricelli54.cpp universe.cpp basic_kernel.cpp scenarios.cpp random_state.cpp trace.cpp checkpoint.cpp cycles.cpp stats.cpp census.cpp counters.cpp render.cpp world_writer.cpp
 //
 // Written by: Tim Taylor <https://www.tim-taylor.com>
 // First release: 10 July 2025
@@ -46,660 +105,530 @@
 
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <format> // from C++20
 #include <string>
 #include <cstring>
-#include <cassert>
 #include <random>
+#include <optional>
+#include <stdexcept>
 #include <algorithm>
-
-enum class Norm {
-    BASIC,
-    SYMBIOTIC,
-    EXCLUSION,
-    CONDITIONAL
-};
-
-struct FindResult {
-    int pos;
-    int num;
+#include <mutex>
+#include <atomic>
+#include <exception>
+
+#include "census.h"
+#include "checkpoint.h"
+#include "counters.h"
+#include "cycles.h"
+#include "render.h"
+#include "scenarios.h"
+#include "stats.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "universe.h"
+#include "world_writer.h"
+
+struct Options {
+    int fig = 0;
+    unsigned int seed = 0;
+    bool seedGiven = false;
+    int numRuns = 0;        // 0 => a single run rather than an ensemble
+    unsigned int numThreads = 0;
+    std::string outPrefix;
+    bool sparse = false;
+    unsigned int stepThreads = 1;
+    std::string checkpointFile;
+    long long checkpointInterval = 1000;
+    std::string resumeFile;
+    bool fastForward = false;
+    bool stats = false;
+    std::string censusFile;
+    bool instrument = false;
+    long long every = 1;        // write every generation that is a multiple of this
+    bool changedOnly = false;
 };
 
-const int NUM_RULES = 25;
-const int X_MARK = 99999;
-
-int worldSize = 10;
-int numGens = 10;
-Norm norm = Norm::BASIC;
-std::vector<int> world;
-std::vector<int> nextWorld;
-
 bool printCSV = false;
-bool debug = false;
+bool printBinary = false;
+bool printImage = false;
+
+// instrumentation counters of all runs so far (with -I)
+Counters totalCounters;
+std::mutex totalCountersMutex;
 
 void printUsageAndExit(const std::string& progname, int rc);
-int  parseFigNumberOrExit(int argc, char** argv);
-std::string getNormName();
-void init(int fig);
-void initWorld(std::vector<int> initlist);
-void printWorld();
-void updateWorld();
-void flipWorlds();
-void updateBasic();
-void updateSymbiotic();
-void reproduceSymbiotic(int i, int j, int level);
-void updateExclusion();
-void reproduceExclusion(int i, int j, int level);
-void updateConditional();
-void reproduceConditional(int i, int j, int level);
-FindResult findNearestNumber(int i, int delta);
+Options parseOptionsOrExit(int argc, char** argv);
+void runScenario(const Options& opts, unsigned int runSeed, std::ostream& os, const std::string& censusFile);
+void runEnsemble(const Options& opts);
 
 /********************************************************** */
 
 int main(int argc, char** argv)
 {
-    int fig = parseFigNumberOrExit(argc, argv);
+    Options opts = parseOptionsOrExit(argc, argv);
 
-    init(fig);
-
-    if (!printCSV) {
-        std::cout << std::format("Figure {}: {} reproduction for {} generations with universe size {}",
-            fig, getNormName(), numGens, worldSize)
-            << std::endl << std::endl;
+    if (!opts.seedGiven) {
+        std::random_device rnd_device;
+        opts.seed = rnd_device();
     }
 
-    printWorld();
-    for (int i=1; i<numGens; ++i) {
-        updateWorld();
-        printWorld();
+    try {
+        if (opts.numRuns > 0) {
+            runEnsemble(opts);
+        }
+        else {
+            runScenario(opts, opts.seed, std::cout, opts.censusFile);
+        }
+        if (opts.instrument) {
+            printCounters(std::cerr, totalCounters);
+        }
     }
-
-    if (!printCSV) {
-        std::cout << std::endl;
+    catch (const std::exception& e) {
+        std::cerr << std::format("Error: {}!", e.what()) << std::endl;
+        exit(1);
     }
 
     return 0;
 }
 
 
-int parseFigNumberOrExit(int argc, char** argv)
+// Run one complete simulation of the given figure/test case (or the rest of
+// one, when resuming from a checkpoint), writing its output to os, and a
+// census of its organisms to censusFile (if not empty)
+void runScenario(const Options& opts, unsigned int runSeed, std::ostream& os, const std::string& censusFile)
 {
-    std::string progname{ argv[0] };
-    std::size_t pos = progname.find_last_of("//");
-    if (pos != std::string::npos && pos < progname.size() - 1) {
-        progname = progname.substr(pos+1);
+    const bool resuming = !opts.resumeFile.empty();
+    Scenario scenario;
+    Checkpoint checkpoint;
+    if (resuming) {
+        checkpoint = readCheckpoint(opts.resumeFile);
+        scenario.fig = checkpoint.info.fig;
+        scenario.worldSize = static_cast<int>(checkpoint.state.size());
+        scenario.numGens = checkpoint.info.numGens;
+        scenario.norm = checkpoint.norm;
+        scenario.randomInit = checkpoint.info.randomInit;
+        scenario.seed = checkpoint.info.seed;
     }
-
-    if (argc < 2 || argc > 3) {
-        printUsageAndExit(progname, 1);
+    else {
+        scenario = makeScenario(opts.fig, runSeed);
     }
 
-    int figIdx = 1;
-
-    if (argc == 3) {
-        if (std::strcmp(argv[1], "-c") == 0) {
-            printCSV = true;
-            figIdx = 2;
-        }
-        else {
-            printUsageAndExit(progname, 1);
-        }
-    }
+    Universe universe = resuming ? checkpoint.makeUniverse()
+                                 : Universe(scenario.worldSize, scenario.norm, scenario.initState);
+    universe.setSparse(opts.sparse);
+    universe.setThreads(opts.stepThreads);
+    universe.setInstrumented(opts.instrument);
 
-    int fig;
-    try {
-        fig = std::stoi(argv[figIdx]);
-        if (fig < 1 || fig > NUM_RULES) {
-            printUsageAndExit(progname, 1);
-        }
+    std::optional<Checkpointer> checkpointer;
+    if (!opts.checkpointFile.empty()) {
+        checkpointer.emplace(opts.checkpointFile,
+            CheckpointInfo { scenario.fig, scenario.numGens, scenario.randomInit, scenario.seed });
     }
-    catch (...) {
-        printUsageAndExit(progname, 1);
-    }
-
-    return fig;
-}
-
-
-void printUsageAndExit(const std::string& progname, int rc) {
-    std::cerr << std::format("Usage: {} [-c] n", progname) << std::endl;
-    std::cerr << std::format("  where n is a figure number between 1 and {} (numbers above 22 are test cases)",
-        NUM_RULES) << std::endl;
-    std::cerr << "        -c specifies CSV output" << std::endl;
-    exit(rc);
-}
-
-
-std::string getNormName()
-{
-    switch (norm) {
-        case Norm::BASIC: return "basic";
-        case Norm::SYMBIOTIC: return "symbiotic";
-        case Norm::EXCLUSION: return "symbiotic+exclusion";
-        case Norm::CONDITIONAL: return "symbiotic+conditional";
-        default: {
-            std::cerr << std::format("Error! Encountered unknown norm {}", (int)norm) << std::endl;
-            exit(1);
-        }
 
+    std::optional<TraceWriter> trace;
+    if (printBinary) {
+        TraceHeader header;
+        header.fig = scenario.fig;
+        header.norm = scenario.norm;
+        header.worldSize = scenario.worldSize;
+        header.numGens = scenario.numGens;
+        header.randomInit = scenario.randomInit;
+        header.seed = scenario.seed;
+        trace.emplace(os, header);
+        trace->append(universe);
     }
-}
-
-
-void init(int fig)
-{
-    switch (fig) {
-        case 1: {
-            worldSize = 62;
-            numGens = 10;
-            norm = Norm::BASIC;
-            initWorld({4,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,-3,0,0,0,0,0,0,0,0,0,0,5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,-1,0,0,0,0,0,0,0,2,0,0,0,0,-8,0});
-            break;
+    else if (!resuming && !printImage) {
+        // a resumed run carries on from the output of the checkpointed generation
+        if (opts.stats) {
+            printStatsHeader(os);
+            printStats(os, measureGeneration(universe));
         }
-        case 2: {
-            worldSize = 17;
-            numGens = 5;
-            norm = Norm::SYMBIOTIC;
-            initWorld({4});
-            break;
+        else if (!printCSV) {
+            os << getScenarioTitle(scenario) << std::endl << std::endl;
         }
-        case 3: {
-            worldSize = 13;
-            numGens = 7;
-            norm = Norm::SYMBIOTIC;
-            initWorld({0,0,0,0,0,0,0,0,0,0,0,0,-2});
-            break;
-        }
-        case 4: {
-            worldSize = 20;
-            numGens = 10;
-            norm = Norm::SYMBIOTIC;
-            initWorld({0,0,0,0,0,0,0,0,4,0,0,0,0,0,0,0,0,0,0,-3});
-            break;
-        }
-        case 5: {
-            worldSize = 11;
-            numGens = 5;
-            norm = Norm::SYMBIOTIC;
-            initWorld({4,0,0,0,0,3,0,0,0,-2});
-            break;
-        }
-        case 6: {
-            worldSize = 20;
-            numGens = 12;
-            norm = Norm::EXCLUSION;
-            initWorld({0,0,5,0,0,0,5,0,1,-3,1,-3});
-            break;
-        }
-        case 7: {
-            worldSize = 41;
-            numGens = 10;
-            norm = Norm::EXCLUSION;
-            initWorld({0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,-3,1,-3,0,-3,1});
-            break;
-        }
-        case 8: {
-            worldSize = 59;
-            numGens = 17;
-            norm = Norm::EXCLUSION;
-            initWorld({9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,0,0,0,0,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3});
-            break;
-        }
-        case 9: {
-            worldSize = 116;
-            numGens = 19;
-            norm = Norm::EXCLUSION;
-            initWorld({0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7});
-            break;
-        }
-        case 10: {
-            worldSize = 56;
-            numGens = 14;
-            norm = Norm::EXCLUSION;
-            initWorld({9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,0,0,0,0,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7});
-            break;
-        }
-        case 11: {
-            worldSize = 84;
-            numGens = 11;
-            norm = Norm::EXCLUSION;
-            initWorld({0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,0,0,0,0,0,0,0,0,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3});
-            break;
-        }
-        case 12: {
-            worldSize = 12;
-            numGens = 7;
-            norm = Norm::CONDITIONAL;
-            initWorld({3,0,0,0,0,2,0,-4});
-            break;
-        }
-        case 13: {
-            worldSize = 6;
-            numGens = 2;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,-2,0,0,-5});
-            break;
-        }
-        case 14: {
-            worldSize = 8;
-            numGens = 2;
-            norm = Norm::CONDITIONAL;
-            initWorld({3,0,0,2,0,0,0,-4});
-            break;
-        }
-        case 15: {
-            worldSize = 83;
-            numGens = 101;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,1,-1,0,0,-1,0,0,-1,0,0,0,1,0,0,1,0,-1,0,0,0,-1,1,1,-1,1,1,1,1,1,0,0,1,-1,1,0,0,-1,-1,0,1,1,-1,0,1,1,1,1,0,-1,-1,-1,0,0,0,-1,0,0,1,-1,0,-1,1,0,-1,0,0,-1,1,0,0,-1,1,-1,1,-1,-1,1,1,0,-1,1,1});
-            break;
-        }
-        case 16: {
-            worldSize = 12;
-            numGens = 6;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,1,-1});
-            break;
-        }
-        case 17: {
-            worldSize = 20;
-            numGens = 39;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,1,-2,1,1,-2,0,1,-2,1,1,-2});
-            break;
-        }
-        case 18: {
-            worldSize = 21;
-            numGens = 20;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,0,1,-1,0,0,1,1,-2,0,1,-2});
-            break;
-        }
-        case 19: {
-            worldSize = 21;
-            numGens = 3;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,0,0,0,4,0,0,0,-4});
-            break;
-        }
-        case 20: {
-            worldSize = 18;
-            numGens = 4;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,0,0,0,0,1,-3,1,-3,1,-3});
-            break;
-        }
-        case 21: {
-            worldSize = 19;
-            numGens = 4;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,0,3,0,0,-3});
-            break;
-        }
-        case 22: {
-            worldSize = 20;
-            numGens = 5;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,0,0,0,0,0,0,0,2,2,-2,-2});
-            break;
-        }
-        case 23: {
-            // Test case: run Figure 15 for the first 9 generations
-            worldSize = 83;
-            numGens = 9;
-            norm = Norm::CONDITIONAL;
-            initWorld({0,1,-1,0,0,-1,0,0,-1,0,0,0,1,0,0,1,0,-1,0,0,0,-1,1,1,-1,1,1,1,1,1,0,0,1,-1,1,0,0,-1,-1,0,1,1,-1,0,1,1,1,1,0,-1,-1,-1,0,0,0,-1,0,0,1,-1,0,-1,1,0,-1,0,0,-1,1,0,0,-1,1,-1,1,-1,-1,1,1,0,-1,1,1});
-            break;
-        }
-        case 24: {
-            // Test case: initialise world with row 8 of Figure 15 and run for just one further generation
-            worldSize = 83;
-            numGens = 2;
-            norm = Norm::CONDITIONAL;
-            initWorld({1,-1,1,-1,1,-1,1,0,0,1,0,0,1,4,-1,0,0,0,1,-1,1,-1,1,-1,1,-1,1,-1,1,-1,1,1,-1,1,-1,1,0,0,0,-1,1,-1,1,-1,1,-1,1,-1,1,-1,0,1,-1,1,-1,1,3,0,-4,0,-4,0,0,0,1,1,-1,1,-1,1,-1,1,X_MARK,X_MARK,X_MARK,1,-2,1,1,-2,0,1,0});
-            break;
-        }
-        case 25: {
-            // Test case: like Barricelli's Figure 15, where he started with a randomly assigned
-            // initial state using tosses of two coins => both heads were marked as a 1, both tails
-            // as -1, and mixed head/tail as 0. Here we use the same probability distribution but
-            // generate a new random state each time the test is called.
-
-            worldSize = 83;
-            numGens = 101;
-            norm = Norm::CONDITIONAL;
-
-            std::random_device rnd_device;
-            std::mt19937 rng { rnd_device() };
-            std::uniform_int_distribution<int> dist {-1, 2}; // generate numbers in range [-1,2]
-
-            std::vector<int> state(worldSize);
-            std::generate(state.begin(), state.end(), [&](){
-                int n = dist(rng);
-                return (n==2) ? 0 : n; // returns "-1" 25% of time, "0" 50% and "1" 25%
-            });
+    }
 
-            initWorld(state);
-            break;
+    // the text or CSV output of the world is written on a background thread,
+    // with as many buffered generations as fit in about 256MB
+    std::optional<WorldWriter> writer;
+    if (!printBinary && !printImage && !opts.stats) {
+        long long worldBytes = std::max<long long>(1, scenario.worldSize * static_cast<long long>(sizeof(Cell)));
+        WorldWriterOptions writerOptions;
+        writerOptions.csv = printCSV;
+        writerOptions.every = opts.every;
+        writerOptions.changedOnly = opts.changedOnly;
+        writerOptions.numBuffers = static_cast<int>(std::clamp<long long>((256ll << 20) / worldBytes, 2, 64));
+        writer.emplace(os, writerOptions);
+        if (resuming) {
+            // with -u, the rows that follow are those that differ from the
+            // last one the interrupted run wrote: the one it recorded with
+            // the checkpoint, or else the checkpointed generation if that
+            // was one of the generations written
+            if (!checkpoint.lastRow.empty()) {
+                writer->skip(checkpoint.lastRow);
+            }
+            else if (opts.changedOnly && checkpoint.generation % opts.every != 0) {
+                throw std::runtime_error(std::format("Checkpoint file {} does not record the last row written, "
+                    "which -u needs to resume from generation {} with -d {}",
+                    opts.resumeFile, checkpoint.generation, opts.every));
+            }
+            else {
+                writer->skip(universe.cells());
+            }
         }
-        default: {
-            std::cerr << std::format("Error: Unexpected figure number encountered ({})!", fig) << std::endl;
-            exit(1);
+        else {
+            writer->write(universe.getGeneration(), universe.cells());
         }
     }
-}
 
-
-void initWorld(std::vector<int> initlist)
-{
-    if (initlist.size() > worldSize) {
-        std::cerr << std::format("Error: Initializer list size ({}) is bigger than world size ({})!", initlist.size(), worldSize) << std::endl;
-        exit(1);
+    // the worlds of the run, for an image drawn once it is complete
+    std::vector<std::vector<int>> image;
+    if (printImage) {
+        image.push_back(universe.state());
     }
 
-    // set world vectors to correct size and initialise elements to 0
-    world.resize(worldSize);
-    nextWorld.resize(worldSize);
-
-    // set initial world stated according to initlist
-    int pos = 0;
-    for (int num : initlist) {
-        world[pos++] = num;
+    std::optional<CycleDetector> cycles;
+    if (opts.fastForward) {
+        cycles.emplace();
+        cycles->observe(universe);
     }
-}
 
+    std::optional<Census> census;
+    if (!censusFile.empty()) {
+        census.emplace(universe.size());
+        census->observe(universe);
+    }
 
-void printWorld()
-{
-    if (printCSV) {
-        for (int i = 0; i < worldSize; ++i) {
-            if (world[i] == X_MARK) {
-                std::cout << "x";
+    for (long long g = universe.getGeneration() + 1; g < scenario.numGens; ++g) {
+        if (cycles && cycles->hasStates()) {
+            // the run has settled into a cycle whose states are all known, so
+            // the rest of the output is produced without simulating it
+            const std::vector<int>& state = cycles->stateAt(g);
+            if (trace) {
+                trace->append(state);
+            }
+            else if (printImage) {
+                image.push_back(state);
+            }
+            else if (opts.stats) {
+                printStats(os, measureState(state, g, cycles->mutationsAt(g)));
             }
             else {
-                std::cout << world[i];
+                writer->write(g, state);
             }
-            if (i < worldSize-1) {
-                std::cout << ",";
+            if (census) {
+                census->observe(g, state);
             }
+            continue;
         }
-    }
-    else {
-        for (int num : world) {
-            std::cout << ((num==0) ? "   " : (num==X_MARK) ? "  x" : std::format("{:3}", num));
-        }
-    }
-    std::cout << std::endl;
-}
-
 
-void updateWorld()
-{
-    switch (norm) {
-        case Norm::BASIC: {
-            updateBasic();
-            break;
+        if (cycles && cycles->found() && writer && !census) {
+            // the cycle's states were too large to record, but only the
+            // generations that are written or checkpointed need computing
+            auto roundUp = [](long long n, long long k) { return (n + k - 1) / k * k; };
+            long long target = std::min<long long>(scenario.numGens - 1, roundUp(g, opts.every));
+            if (checkpointer) {
+                target = std::min(target, roundUp(g, opts.checkpointInterval));
+            }
+            fastForward(universe, *cycles, target);
+            g = target;
         }
-        case Norm::SYMBIOTIC: {
-            updateSymbiotic();
-            break;
+        else {
+            universe.step();
         }
-        case Norm::EXCLUSION: {
-            updateExclusion();
-            break;
+        if (trace) {
+            trace->append(universe);
         }
-        case Norm::CONDITIONAL: {
-            updateConditional();
-            break;
+        else if (printImage) {
+            image.push_back(universe.state());
         }
-        default: {
-            std::cerr << std::format("Encountered unknown norm {}!", (int)norm) << std::endl;
-            exit(1);
+        else if (opts.stats) {
+            printStats(os, measureGeneration(universe));
         }
-    }
-
-    flipWorlds();
-}
-
-
-void flipWorlds()
-{
-    world = std::move(nextWorld);
-    nextWorld.assign(worldSize, 0);
-}
-
-
-// Basic update procedure, as described in Section 2 of (Barricelli, 1954)
-void updateBasic()
-{
-    for (int i=0; i<worldSize; ++i) {
-        // copy state to same position on next line
-        int x = (nextWorld[i] != 0) ? world[i] : 0;         // collision rule for basic reproduction
-        nextWorld[i] += (world[i]-x);
-
-        // reproduce state elsewhere on next line
-        if (world[i] != 0) {
-            int c = i + world[i];
-            if (c >= 0 && c < worldSize) {
-                int x = (nextWorld[c] != 0) ? world[c] : 0; // collision rule for basic reproduction
-                nextWorld[c] += (world[i] - x);
+        else {
+            writer->write(universe.getGeneration(), universe.cells());
+        }
+        if (checkpointer && universe.getGeneration() % opts.checkpointInterval == 0) {
+            // flush the output first, so that after a crash it holds every
+            // generation up to the last checkpoint
+            if (writer) {
+                writer->flush();
             }
+            os.flush();
+            checkpointer->save(universe, writer ? writer->lastWritten() : nullptr);
+        }
+        if (cycles) {
+            cycles->observe(universe);
+        }
+        if (census) {
+            census->observe(universe);
         }
     }
-}
-
 
-// Symbiotic update procedure, as described in Section 4 of (Barricelli, 1954)
-void updateSymbiotic()
-{
-    for (int i=0; i<worldSize; ++i) {
-        // if this cell contains a number (not blank(0)), attempt to reproduce it
-        if (world[i] != 0) {
-            reproduceSymbiotic(i, i+world[i], 1);
+    if (trace) {
+        trace->finish();
+    }
+    else if (printImage) {
+        writePng(os, renderWorlds(image, RenderOptions {}));
+    }
+    else if (writer) {
+        writer->finish();
+        if (!printCSV) {
+            os << std::endl;
         }
     }
-}
-
+    if (checkpointer) {
+        checkpointer->wait();
+    }
 
-// Recursive helper function for updateSymbiotic() to implement
-// the symbiotic reproduction process.
-//
-// This function reproduces the number at location i in current world into
-// location j in the updated world. It then checks whether location j
-// is occupied in the current world - if it is, and its content
-// is not the same as at location i, then it calls this function
-// recursively to reproduce the number at location i into the
-// the location given by i offset by the content of location j.
-//
-void reproduceSymbiotic(int i, int j, int level)
-{
-    // first do a belt and braces check to guard against infinite recursion
-    if (level > worldSize) {
-        return;
-    }
-
-    if ((j >= 0) && (j < worldSize)) {
-        // reproduce number in cell i into cell j of next generation
-        nextWorld[j] = world[i];
-        // if the new contents of cell j comes below a different (non-zero) number,
-        // then reproduce it in cell (i + [contents of j])
-        if ((world[j] != 0) && (world[j] != world[i])) {
-            reproduceSymbiotic(i, i+world[j], ++level);
+    if (census) {
+        std::ofstream file(censusFile);
+        if (!file) {
+            throw std::runtime_error(std::format("Unable to open census file {}", censusFile));
         }
+        census->printReport(file);
+    }
+
+    if (opts.instrument) {
+        std::lock_guard<std::mutex> lock(totalCountersMutex);
+        totalCounters.merge(universe.getCounters());
     }
 }
 
 
-// Exclusion update procedure ("exclusion norm"), as described in Section 4 of (Barricelli, 1954)
-void updateExclusion()
+// Run opts.numRuns replicates of a scenario on a work-stealing thread pool.
+// Replicate k is seeded with opts.seed+k. Output goes either to one file per
+// replicate (if an output prefix was given) or to standard output, in run order.
+// If a replicate fails, those not yet started are abandoned and its error is
+// rethrown once the others have finished.
+void runEnsemble(const Options& opts)
 {
-    for (int i=0; i<worldSize; ++i) {
-        // if this cell contains a number (not blank(0) or X), attempt to reproduce it
-        if ((world[i] != 0) && (world[i] != X_MARK)) {
-            reproduceExclusion(i, i+world[i], 1);
+    const std::string ext = printBinary ? "b54" : printImage ? "png" : (printCSV || opts.stats) ? "csv" : "txt";
+    const bool toFiles = !opts.outPrefix.empty();
+    std::vector<std::string> results(toFiles ? 0 : opts.numRuns);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::atomic<bool> failed { false };
+
+    {
+        WorkStealingPool pool(opts.numThreads);
+        for (int k = 0; k < opts.numRuns; ++k) {
+            pool.submit([&, k]() {
+                if (failed) {
+                    return;
+                }
+                unsigned int runSeed = opts.seed + k;
+                std::string censusFile = opts.censusFile.empty() ? "" : std::format("{}-{}.csv", opts.censusFile, k);
+                try {
+                    if (toFiles) {
+                        std::string filename = std::format("{}-{}.{}", opts.outPrefix, k, ext);
+                        std::ofstream file(filename, (printBinary || printImage) ? std::ios::binary : std::ios::out);
+                        if (!file) {
+                            throw std::runtime_error(std::format("Unable to open output file {}", filename));
+                        }
+                        runScenario(opts, runSeed, file, censusFile);
+                    }
+                    else {
+                        std::ostringstream buffer;
+                        runScenario(opts, runSeed, buffer, censusFile);
+                        results[k] = std::move(buffer).str();
+                    }
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            });
         }
+        pool.wait();
     }
-}
 
-
-// Recursive helper function for updateExclusion() to implement
-// the exclusion norm.
-//
-// This function attempts to reproduce the number at location i in current world into
-// location j in the updated world. If location j in the updated world is already
-// occupied, and the contents is different to the number we are trying to reproduce,
-// then an exlusion mark (X_MARK) is placed in location j instead.
-// Regardless of whether the number was copied or an X_MARK was written, the
-// function then checks whether location j is occupied in the current world - if it is,
-// and its content is not the same as at location i, then we call this function
-// recursively to reproduce the number at location i into the
-// the location given by i offset by the content of location j.
-//
-void reproduceExclusion(int i, int j, int level)
-{
-    // first do a belt and braces check to guard against infinite recursion
-    if (level > worldSize) {
-        return;
+    if (error) {
+        std::rethrow_exception(error);
     }
 
-    if ((j >= 0) && (j < worldSize)) {
-        if (nextWorld[j] == 0) {
-            // the destination cell is blank, so go ahead
-            nextWorld[j] = world[i];
+    if (toFiles) {
+        std::string filename = std::format("{}-seeds.csv", opts.outPrefix);
+        std::ofstream seeds(filename);
+        if (!seeds) {
+            throw std::runtime_error(std::format("Unable to open output file {}", filename));
         }
-        else if (nextWorld[j] == world[i]) {
-            // the destination cell contains the same number that we want to move
-            // to it, so do nothing in this case (the current number remains)
-        }
-        else {
-            // the destination cell is neither blank nor contains the same
-            // number that we want to move to it, so mark it with
-            // an exclusion mark
-            nextWorld[j] = X_MARK;
-        }
-        if ((world[j] != 0) && (world[j] != X_MARK) && (world[j] != world[i]) && (i+world[j] != j)) {
-            // if the new contents of cell j comes below a different (non-zero) number,
-            // then reproduce it in cell (i + [contents of j]). The final condition
-            // in the line above (i+world[j] != j) ensures we don't waste our time trying to move
-            // into the same cell j as we have just handeled in the current call to this function.
-            reproduceExclusion(i, i+world[j], ++level);
+        seeds << "run,seed\n";
+        for (int k = 0; k < opts.numRuns; ++k) {
+            seeds << std::format("{},{}\n", k, opts.seed + k);
         }
     }
-}
-
-
-// Conditional update procedure, as described in Section 5 of (Barricelli, 1954)
-void updateConditional()
-{
-    for (int i=0; i<worldSize; ++i) {
-        if ((world[i] != 0) && (world[i] != X_MARK)) {
-            // if this cell contains a number (not blank(0) or X), attempt to reproduce it
-            reproduceConditional(i, i+world[i], 1);
+    else {
+        for (int k = 0; k < opts.numRuns; ++k) {
+            std::cout << std::format("# run {} seed {}\n", k, opts.seed + k) << results[k];
         }
+        std::cout.flush();
     }
 }
 
 
-// Recursive helper function for updateConditional() to implement
-// the conditional norm.
-//
-// This function attempts to reproduce the number at location i in current world into
-// location j in the updated world. If location j in the updated world is already
-// occupied, and the contents is different to the number we are trying to reproduce,
-// then an exlusion mark (X_MARK) is placed in location j instead.
-// If the exclusion mark falls under an empty cell, or another X_MARK, it is replaced
-// by a number equal to the distance between the nearest number to the left and the
-// nearest number to the right of the aforementioned empty cell. If the two said
-// numbers have the same sign, then the new number (distance) is given a positive
-// sign, otherwise a negative sign.
-// Regardless of whether the number was copied or an X_MARK was written, the
-// function then checks whether location j is occupied in the current world - if it is,
-// and its content is not the same as at location i, then we call this function
-// recursively to reproduce the number at location i into the
-// the location given by i offset by the content of location j.
-//
-void reproduceConditional(int i, int j, int level)
+Options parseOptionsOrExit(int argc, char** argv)
 {
-    // first do a belt and braces check to guard against infinite recursion
-    if (level > worldSize) {
-        return;
+    std::string progname{ argv[0] };
+    std::size_t pos = progname.find_last_of("//");
+    if (pos != std::string::npos && pos < progname.size() - 1) {
+        progname = progname.substr(pos+1);
     }
 
-    if (debug) {
-        std::cout << std::format("reproduceConditional: i={:2}, j={:2}, level={:2}",i,j,level) << std::endl;
-    }
+    Options opts;
+    bool figGiven = false;
 
-    if ((j >= 0) && (j < worldSize)) {
-        if (nextWorld[j] == 0) {
-            // the destination cell is blank, so go ahead
-            nextWorld[j] = world[i];
-        }
-        else if (nextWorld[j] == world[i]) {
-            // the destination cell contains the same number that we want to move
-            // to it, so do nothing in this case (the current number remains)
-        }
-        else {
-            // the destination cell contains a number different to the one we
-            // are attempting to move into it - so potentially mark it with X_MARK
-            // or produce a mutation
-
-            if (world[j] != 0 && world[j] != X_MARK) {
-                // the cell above our destination cell contains a number, so the
-                // place an X_MARK in the destination cell
-                nextWorld[j] = X_MARK;
+    try {
+        for (int a = 1; a < argc; ++a) {
+            std::string arg { argv[a] };
+            bool hasValue = (a+1 < argc);
+            if (arg == "-c") {
+                printCSV = true;
             }
-            else {
-                // the cell above our destination cell is either blank or
-                // contains an X_MARK, so consider placing a mutated number in
-                // the destination cell
-                auto [lpos, lnum] = findNearestNumber(j, -1);
-                auto [rpos, rnum] = findNearestNumber(j, 1);
-                if (lpos == X_MARK || rpos == X_MARK) {
-                    // no number found to the left and/or right of the empty cell,
-                    // so he destintaion cell gets an X_MARK
-                    nextWorld[j] = X_MARK;
+            else if (arg == "-b") {
+                printBinary = true;
+            }
+            else if (arg == "-P") {
+                printImage = true;
+            }
+            else if (arg == "-p") {
+                opts.sparse = true;
+            }
+            else if (arg == "-S") {
+                opts.stats = true;
+            }
+            else if (arg == "-f") {
+                opts.fastForward = true;
+            }
+            else if (arg == "-I") {
+                opts.instrument = true;
+            }
+            else if (arg == "-t" && hasValue) {
+                opts.stepThreads = static_cast<unsigned int>(std::stoul(argv[++a]));
+                if (opts.stepThreads < 1) {
+                    printUsageAndExit(progname, 1);
                 }
-                else {
-                    // we found the closest numbers to the left and right of the
-                    // empty cell, so the destination cell gets assigned a number
-                    // corresponding to the distance between these two found cells.
-                    // The sign of the assigned number is positive if the found numbers
-                    // are of equal sign, or negative otherwise
-                    nextWorld[j] = (rpos-lpos) * ((lnum * rnum) > 0 ? 1 : -1);
+            }
+            else if (arg == "-C" && hasValue) {
+                opts.censusFile = argv[++a];
+            }
+            else if (arg == "-k" && hasValue) {
+                opts.checkpointFile = argv[++a];
+            }
+            else if (arg == "-K" && hasValue) {
+                opts.checkpointInterval = std::stoll(argv[++a]);
+                if (opts.checkpointInterval < 1) {
+                    printUsageAndExit(progname, 1);
                 }
             }
-        }
-        if ((world[j] != 0) && (world[j] != X_MARK) && (world[j] != world[i]) && ((i+world[j]) != j)) {
-            if (debug) {
-                std::cout << "recurse" << std::endl;
+            else if (arg == "-d" && hasValue) {
+                opts.every = std::stoll(argv[++a]);
+                if (opts.every < 1) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-u") {
+                opts.changedOnly = true;
+            }
+            else if (arg == "-r" && hasValue) {
+                opts.resumeFile = argv[++a];
+            }
+            else if (arg == "-s" && hasValue) {
+                opts.seed = static_cast<unsigned int>(std::stoul(argv[++a]));
+                opts.seedGiven = true;
+            }
+            else if (arg == "-e" && hasValue) {
+                opts.numRuns = std::stoi(argv[++a]);
+                if (opts.numRuns < 1) {
+                    printUsageAndExit(progname, 1);
+                }
+            }
+            else if (arg == "-j" && hasValue) {
+                opts.numThreads = static_cast<unsigned int>(std::stoul(argv[++a]));
+            }
+            else if (arg == "-o" && hasValue) {
+                opts.outPrefix = argv[++a];
+            }
+            else if (!figGiven && !arg.empty() && arg[0] != '-') {
+                opts.fig = std::stoi(arg);
+                figGiven = true;
+            }
+            else {
+                printUsageAndExit(progname, 1);
             }
-            // if the new contents of cell j comes below a different (non-zero) number,
-            // then reproduce it in cell (i + [contents of j]). The final condition
-            // in the line above (i+world[j] != j) ensures we don't waste our time trying to move
-            // into the same cell j as we have just handeled in the current call to this function.
-            reproduceConditional(i, i+world[j], ++level);
         }
     }
-}
+    catch (...) {
+        printUsageAndExit(progname, 1);
+    }
 
+    if (!opts.resumeFile.empty()) {
+        // the scenario comes from the checkpoint, and the rest of a trace or
+        // image cannot be appended to that of the interrupted run
+        if (figGiven || printBinary || printImage || opts.numRuns > 0) {
+            printUsageAndExit(progname, 1);
+        }
+    }
+    else if (!figGiven || opts.fig < 1 || opts.fig > NUM_RULES) {
+        printUsageAndExit(progname, 1);
+    }
 
-// Helper function to find the position of the nearest cell to cell i that is
-// occupied by a number. The paramater delta specifies the direction of the
-// search (1=right, -1=left).
-// Returns a FindResults object containing the index and contents of the
-// found cell, or {X_MARK, X_MARK} is the edge of the world is reached without
-// finding an occupied cell.
-FindResult findNearestNumber(int i, int delta) {
-    assert(delta == 1 || delta == -1);
+    if (opts.numRuns > 0 && !opts.checkpointFile.empty()) {
+        // checkpoints are for single long runs
+        printUsageAndExit(progname, 1);
+    }
 
-    int pos = i + delta;
-    while ((pos >= 0) && (pos < worldSize)) {
-        if ((world[pos] != 0) && (world[pos] != X_MARK)) {
-            return {pos, world[pos]};
-        }
-        pos += delta;
+    if (opts.numRuns == 0 && (opts.numThreads != 0 || !opts.outPrefix.empty())) {
+        // -j and -o only make sense for an ensemble
+        printUsageAndExit(progname, 1);
+    }
+
+    if (printBinary && (printCSV || opts.stats || (opts.numRuns > 0 && opts.outPrefix.empty()))) {
+        // a binary trace has no CSV or statistics form, and an ensemble's traces each need their own file
+        printUsageAndExit(progname, 1);
     }
 
-    return {X_MARK, X_MARK};
+    if (printImage && (printCSV || printBinary || opts.stats || (opts.numRuns > 0 && opts.outPrefix.empty()))) {
+        // likewise for an image
+        printUsageAndExit(progname, 1);
+    }
+
+    if ((opts.every > 1 || opts.changedOnly) && (printBinary || printImage || opts.stats)) {
+        // only the text and CSV output of the world is decimated
+        printUsageAndExit(progname, 1);
+    }
+
+    return opts;
+}
+
+
+void printUsageAndExit(const std::string& progname, int rc) {
+    std::cerr << std::format("Usage: {} [-c|-b|-S|-P] [-p] [-f] [-I] [-t threads] [-C file] [-k file [-K gens]] [-d every] [-u] [-s seed] [-e runs [-j threads] [-o prefix]] n", progname) << std::endl;
+    std::cerr << std::format("       {} [-c|-S] [-p] [-f] [-I] [-t threads] [-C file] [-k file [-K gens]] [-d every] [-u] -r file", progname) << std::endl;
+    std::cerr << std::format("  where n is a figure number between 1 and {} (numbers above 22 are test cases)",
+        NUM_RULES) << std::endl;
+    std::cerr << "        -c specifies CSV output" << std::endl;
+    std::cerr << "        -b specifies binary trace output (convert it to text with b54trace)" << std::endl;
+    std::cerr << "        -P specifies output of a PNG image of the run (render CSV or traces with b54render)" << std::endl;
+    std::cerr << "        -S specifies output of per-generation statistics rather than the world" << std::endl;
+    std::cerr << "        -p specifies sparse execution (visit only occupied cells)" << std::endl;
+    std::cerr << "        -f fast-forwards through the rest of a run once it has settled into a cycle" << std::endl;
+    std::cerr << "        -I reports the instrumentation counters at the end of the run" << std::endl;
+    std::cerr << "        -t sets the number of threads used to compute each generation (default: 1)" << std::endl;
+    std::cerr << "        -C writes a census of the species of organisms to file (file-<k>.csv for an ensemble)" << std::endl;
+    std::cerr << "        -k writes a checkpoint of the run to file every 1000 (or -K) generations" << std::endl;
+    std::cerr << "        -r resumes the run checkpointed in file, continuing its output" << std::endl;
+    std::cerr << "        -d writes only the generations that are a multiple of every (text or CSV output)" << std::endl;
+    std::cerr << "        -u writes only the generations whose world differs from the last one written" << std::endl;
+    std::cerr << "        -s sets the seed for scenarios with a random initial state" << std::endl;
+    std::cerr << "        -e runs an ensemble of replicates in parallel (replicate k uses seed+k)" << std::endl;
+    std::cerr << "        -j sets the number of threads for an ensemble (default: one per core)" << std::endl;
+    std::cerr << "        -o writes each replicate to <prefix>-<k>.csv|txt|b54|png and seeds to <prefix>-seeds.csv" << std::endl;
+    exit(rc);
 }
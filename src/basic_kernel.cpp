@@ -0,0 +1,190 @@
+// basic_kernel.cpp
+//
+// Scalar and vectorised kernels for the basic reproduction norm (see
+// basic_kernel.h).
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "basic_kernel.h"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define B54_X86_KERNELS 1
+#endif
+
+
+// A block of the vectorised kernels with more than this percentage of its
+// cells occupied is updated by basicInlineRange() rather than with blends
+static constexpr int DENSE_BLOCK_PERCENT = 25;
+
+
+// Reproduce the number wi in cell i into cell i+wi of the next generation
+static inline void basicShift(const CellBuffer& world, CellBuffer& nextWorld, int i, int wi)
+{
+    int c = i + wi;
+    if (c >= 0 && c < world.size()) {
+        int x = (!nextWorld.isBlank(c)) ? world.get(c) : 0; // collision rule for basic reproduction
+        nextWorld.set(c, nextWorld.get(c) + (wi - x));
+    }
+}
+
+
+// Basic update procedure, as described in Section 2 of (Barricelli, 1954),
+// applied to the cells in the range [begin, end)
+static void basicRange(const CellBuffer& world, CellBuffer& nextWorld, int begin, int end)
+{
+    for (int i=begin; i<end; ++i) {
+        int wi = world.get(i);
+
+        // copy state to same position on next line
+        int x = (!nextWorld.isBlank(i)) ? wi : 0;           // collision rule for basic reproduction
+        nextWorld.set(i, nextWorld.get(i) + (wi-x));
+
+        // reproduce state elsewhere on next line
+        if (wi != 0) {
+            basicShift(world, nextWorld, i, wi);
+        }
+    }
+}
+
+
+// The basic update of the cells in [begin, end), which must all hold inline
+// values (no X_MARKs or escaped values), working on the stored codes
+// directly. Only a write into a cell holding an X_MARK or escaped value, or
+// whose result needs escaping, goes through the CellBuffer. This is the
+// vectorised kernels' path for blocks dense enough that blending in their
+// copies in place would not pay.
+static inline void basicInlineRange(const CellBuffer& world, CellBuffer& nextWorld, int begin, int end)
+{
+    const int n = world.size();
+    const Cell* w = world.data();
+    Cell* next = nextWorld.data();
+    for (int i = begin; i < end; ++i) {
+        int wi = w[i];
+
+        // copy state to same position on next line, if it is still blank
+        int ni = next[i];
+        next[i] = static_cast<Cell>((ni != 0) ? ni : wi);
+
+        // reproduce state elsewhere on next line (without branching on the
+        // cell being blank: for wi == 0 the write below leaves cell i as it is)
+        int c = i + wi;
+        if (c < 0 || c >= n) [[unlikely]] {
+            continue;
+        }
+        int nc = next[c];
+        int wc = w[c];
+        int sum = (nc != 0) ? nc + (wi - wc) : wi;  // collision rule for basic reproduction
+        bool inline_ = (nc == 0) || (nc >= CELL_MIN && wc >= CELL_MIN);
+        if (inline_ && sum >= CELL_MIN && sum <= CELL_MAX) [[likely]] {
+            next[c] = static_cast<Cell>(sum);
+        }
+        else if (wi != 0) {
+            basicShift(world, nextWorld, i, wi);
+        }
+    }
+}
+
+
+void updateBasicScalar(const CellBuffer& world, CellBuffer& nextWorld)
+{
+    basicRange(world, nextWorld, 0, world.size());
+}
+
+
+#ifdef B54_X86_KERNELS
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2 {
+
+struct Ops {
+    using Vec = __m256i;
+    static constexpr int LANES = 32 / sizeof(Cell);
+    static constexpr unsigned FULL_MASK = 0xFFFFFFFFu;
+
+    static Vec load(const Cell* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(Cell* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Vec zero() { return _mm256_setzero_si256(); }
+    static bool allZero(Vec v) { return _mm256_testz_si256(v, v); }
+    static unsigned movemask(Vec v) { return static_cast<unsigned>(_mm256_movemask_epi8(v)); }
+    static Vec blend(Vec a, Vec b, Vec mask) { return _mm256_blendv_epi8(a, b, mask); }
+#if B54_CELL_BITS == 8
+    static Vec set1(Cell c) { return _mm256_set1_epi8(c); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm256_cmpgt_epi8(a, b); }
+#elif B54_CELL_BITS == 16
+    static Vec set1(Cell c) { return _mm256_set1_epi16(c); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi16(a, b); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm256_cmpgt_epi16(a, b); }
+#else
+    static Vec set1(Cell c) { return _mm256_set1_epi32(c); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi32(a, b); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm256_cmpgt_epi32(a, b); }
+#endif
+};
+
+#include "basic_kernel_simd.inc"
+
+} // namespace avx2
+#pragma GCC pop_options
+
+
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+namespace sse41 {
+
+struct Ops {
+    using Vec = __m128i;
+    static constexpr int LANES = 16 / sizeof(Cell);
+    static constexpr unsigned FULL_MASK = 0xFFFFu;
+
+    static Vec load(const Cell* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(Cell* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Vec zero() { return _mm_setzero_si128(); }
+    static bool allZero(Vec v) { return _mm_testz_si128(v, v); }
+    static unsigned movemask(Vec v) { return static_cast<unsigned>(_mm_movemask_epi8(v)); }
+    static Vec blend(Vec a, Vec b, Vec mask) { return _mm_blendv_epi8(a, b, mask); }
+#if B54_CELL_BITS == 8
+    static Vec set1(Cell c) { return _mm_set1_epi8(c); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_epi8(a, b); }
+#elif B54_CELL_BITS == 16
+    static Vec set1(Cell c) { return _mm_set1_epi16(c); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi16(a, b); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_epi16(a, b); }
+#else
+    static Vec set1(Cell c) { return _mm_set1_epi32(c); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi32(a, b); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_epi32(a, b); }
+#endif
+};
+
+#include "basic_kernel_simd.inc"
+
+} // namespace sse41
+#pragma GCC pop_options
+
+#endif // B54_X86_KERNELS
+
+
+BasicKernel selectBasicKernel(const char** name)
+{
+#ifdef B54_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        if (name) *name = "avx2";
+        return avx2::updateBasicVector;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        if (name) *name = "sse4.1";
+        return sse41::updateBasicVector;
+    }
+#endif
+    if (name) *name = "scalar";
+    return updateBasicScalar;
+}
@@ -0,0 +1,37 @@
+// basic_kernel.h
+//
+// Whole-world kernels for one generation of the basic reproduction norm.
+//
+// Besides the plain scalar loop there are SSE4.1 and AVX2 versions, which
+// process a block of cells at a time: blank blocks are skipped outright, and
+// the copy-in-place step of the norm is done with vector blends, leaving only
+// the shifted copies to be written one at a time. Cells for which doing the
+// copy in place early could change the result (those receiving a number
+// reproduced forward from an earlier cell of the same block) have their copy
+// done in order instead, and blocks holding X_MARKs or escaped wide values are
+// handed to the scalar loop, so every kernel produces exactly the same next
+// generation. In a block with more than a quarter of its cells occupied the
+// shifted copies dominate, and the blend would only add to them, so such a
+// block is instead updated one cell at a time on the stored codes, without
+// branching on the cells' values. The best kernel for the CPU is chosen at
+// run time; the random-scalar cases of b54bench show its speedup over the
+// scalar kernel.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "cell.h"
+
+// A kernel reads world and adds the basic-norm reproductions of all of its
+// cells into nextWorld (which must be blank on entry)
+using BasicKernel = void (*)(const CellBuffer& world, CellBuffer& nextWorld);
+
+// The reference scalar kernel
+void updateBasicScalar(const CellBuffer& world, CellBuffer& nextWorld);
+
+// The fastest kernel supported by the CPU we are running on. If name is not
+// null, it is set to a short description of the chosen kernel.
+BasicKernel selectBasicKernel(const char** name = nullptr);
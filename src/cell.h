@@ -0,0 +1,154 @@
+// cell.h
+//
+// Compact storage of the cells of a universe.
+//
+// Cell values are stored in a narrow signed integer type chosen at build time
+// with the B54_CELL_BITS macro (8, 16 or 32; default 16). The most negative
+// value of the type is reserved for the exclusion mark, and the next one for
+// an escape code: the rare values that do not fit in the narrow type (e.g. the
+// mutations produced by the conditional norm in a very large universe) are
+// stored as the escape code, with the full value kept in a small side table.
+// Whatever the storage type, the cell values seen through CellBuffer::get()
+// are exactly those of a universe of plain ints, with X_MARK denoting an
+// exclusion mark.
+//
+// Different threads may get and set different cells of one CellBuffer at the
+// same time (the side table is guarded by a lock, taken only for wide values).
+//
+// A CellBuffer takes its memory from a std::pmr::memory_resource (by default
+// the global heap), and once sized it allocates nothing more except for the
+// entries of the side table, which a pool resource recycles. A copy of a
+// CellBuffer takes its memory from the global heap.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef B54_CELL_BITS
+#define B54_CELL_BITS 16
+#endif
+
+#if B54_CELL_BITS == 8
+using Cell = std::int8_t;
+#elif B54_CELL_BITS == 16
+using Cell = std::int16_t;
+#elif B54_CELL_BITS == 32
+using Cell = std::int32_t;
+#else
+#error "B54_CELL_BITS must be 8, 16 or 32"
+#endif
+
+const int X_MARK = 99999;
+
+const Cell CELL_X = std::numeric_limits<Cell>::min();    // stored exclusion mark
+const Cell CELL_ESCAPE = CELL_X + 1;                     // value held in the side table
+const int CELL_MIN = CELL_ESCAPE + 1;                    // smallest value stored inline
+const int CELL_MAX = std::numeric_limits<Cell>::max();   // largest value stored inline
+
+
+class CellBuffer {
+public:
+    CellBuffer() = default;
+    explicit CellBuffer(std::pmr::memory_resource* memory) : cells(memory), wide(memory) {}
+    CellBuffer(const CellBuffer& other) : cells(other.cells), wide(other.wide) {}
+    CellBuffer(CellBuffer&& other) noexcept : cells(std::move(other.cells)), wide(std::move(other.wide)) {}
+    CellBuffer& operator=(const CellBuffer& other)
+    {
+        cells = other.cells;
+        wide = other.wide;
+        return *this;
+    }
+    CellBuffer& operator=(CellBuffer&& other) noexcept
+    {
+        cells = std::move(other.cells);
+        wide = std::move(other.wide);
+        return *this;
+    }
+
+    // Resize to n cells, all blank
+    void assign(int n)
+    {
+        cells.assign(n, 0);
+        wide.clear();
+    }
+
+    int size() const { return static_cast<int>(cells.size()); }
+
+    // The value of cell i (X_MARK for an exclusion mark)
+    int get(int i) const
+    {
+        Cell c = cells[i];
+        if (c > CELL_ESCAPE) [[likely]] {
+            return c;
+        }
+        if (c == CELL_X) {
+            return X_MARK;
+        }
+        std::lock_guard<std::mutex> lock(wideMutex);
+        return wide.at(i);
+    }
+
+    void set(int i, int v)
+    {
+        if (cells[i] == CELL_ESCAPE) {
+            std::lock_guard<std::mutex> lock(wideMutex);
+            wide.erase(i);
+        }
+        if (v == X_MARK) {
+            cells[i] = CELL_X;
+        }
+        else if (v >= CELL_MIN && v <= CELL_MAX) [[likely]] {
+            cells[i] = static_cast<Cell>(v);
+        }
+        else {
+            cells[i] = CELL_ESCAPE;
+            std::lock_guard<std::mutex> lock(wideMutex);
+            wide[i] = v;
+        }
+    }
+
+    // Blank the cells in the range [begin, end)
+    void clear(int begin, int end)
+    {
+        std::fill(cells.begin() + begin, cells.begin() + end, 0);
+        std::lock_guard<std::mutex> lock(wideMutex);
+        if (!wide.empty()) {
+            std::erase_if(wide, [=](const auto& entry) { return entry.first >= begin && entry.first < end; });
+        }
+    }
+
+    bool isBlank(int i) const { return cells[i] == 0; }
+
+    // True if cell i holds a number (i.e. is neither blank nor an exclusion mark)
+    bool isNumber(int i) const { return (cells[i] != 0) && (cells[i] != CELL_X); }
+
+    // Direct access to the stored codes, for vectorised kernels. Any code below
+    // CELL_MIN is an exclusion mark or escaped value, and must be handled via get/set.
+    const Cell* data() const { return cells.data(); }
+    Cell* data() { return cells.data(); }
+
+    // The number of cells currently holding a value too wide for the storage type
+    std::size_t numWide() const { return wide.size(); }
+
+    void swap(CellBuffer& other)
+    {
+        cells.swap(other.cells);
+        wide.swap(other.wide);
+    }
+
+private:
+    std::pmr::vector<Cell> cells;
+    std::pmr::unordered_map<int, int> wide;
+    mutable std::mutex wideMutex;
+};
@@ -0,0 +1,222 @@
+// census.cpp
+//
+// Implementation of the organism census declared in census.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "census.h"
+
+#include <algorithm>
+#include <format> // from C++20
+#include <iterator>
+#include <ostream>
+#include <string>
+
+namespace {
+
+// Whether a cell value can be part of an organism
+bool isOrganismCell(int v)
+{
+    return (v != 0) && (v != X_MARK);
+}
+
+std::string genomeString(const std::vector<int>& genome)
+{
+    std::string s;
+    for (std::size_t k = 0; k < genome.size(); ++k) {
+        if (k > 0) {
+            s += ' ';
+        }
+        s += std::to_string(genome[k]);
+    }
+    return s;
+}
+
+} // namespace
+
+
+Census::Census(int worldSize)
+    : worldSize(worldSize), mirror(worldSize, 0)
+{
+}
+
+
+void Census::observe(const Universe& universe)
+{
+    changed.clear();
+    nextNonBlank.clear();
+    universe.forEachNonBlank([&](int i, int v) {
+        nextNonBlank.push_back(i);
+        if (mirror[i] != v) {
+            changed.push_back(i);
+            mirror[i] = v;
+        }
+    });
+    std::size_t numSet = changed.size();
+    for (int i : nonBlank) {
+        if (universe.cell(i) == 0) {
+            changed.push_back(i);
+            mirror[i] = 0;
+        }
+    }
+    std::inplace_merge(changed.begin(), changed.begin() + numSet, changed.end());
+    nonBlank.swap(nextNonBlank);
+
+    update(universe.getGeneration());
+}
+
+
+void Census::observe(long long generation, const std::vector<int>& state)
+{
+    changed.clear();
+    nonBlank.clear();
+    for (int i = 0; i < worldSize; ++i) {
+        if (state[i] != mirror[i]) {
+            changed.push_back(i);
+            mirror[i] = state[i];
+        }
+        if (state[i] != 0) {
+            nonBlank.push_back(i);
+        }
+    }
+
+    update(generation);
+}
+
+
+// Update the organisms and species now that mirror holds the given
+// generation, in which the cells listed in changed (in increasing order) are
+// the ones that differ from the last generation
+void Census::update(long long generation)
+{
+    // an organism can only have changed if it covered a changed cell or one
+    // next to it (which it may now have merged with, or split at)
+    removed.clear();
+    for (int c : changed) {
+        for (int d = std::max(0, c - 1); d <= std::min(worldSize - 1, c + 1); ++d) {
+            auto it = organisms.upper_bound(d);
+            if (it == organisms.begin()) {
+                continue;
+            }
+            --it;
+            if (it->second.end < d) {
+                continue;
+            }
+            --species[it->second.species].count;
+            removed.push_back(*it);
+            organisms.erase(it);
+        }
+    }
+    std::sort(removed.begin(), removed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // every organism now covering one of those cells is new (an unchanged
+    // organism next to them would have been touching a changed cell)
+    int coveredUntil = -1;
+    for (int c : changed) {
+        for (int d = std::max(0, c - 1); d <= std::min(worldSize - 1, c + 1); ++d) {
+            if (d <= coveredUntil || !isOrganismCell(mirror[d])) {
+                continue;
+            }
+            int start = d;
+            while (start > 0 && isOrganismCell(mirror[start - 1])) {
+                --start;
+            }
+            int end = d;
+            while (end + 1 < worldSize && isOrganismCell(mirror[end + 1])) {
+                ++end;
+            }
+            addOrganism(start, end, generation);
+            coveredUntil = end;
+        }
+    }
+
+    // bring the tallies of the living species up to date
+    for (std::size_t k = 0; k < living.size(); ) {
+        Species* sp = living[k];
+        if (sp->count == 0) {
+            sp->alive = false;
+            living[k] = living.back();
+            living.pop_back();
+            continue;
+        }
+        sp->lastSeen = generation;
+        sp->organismGenerations += sp->count;
+        if (sp->count > sp->peakCount) {
+            sp->peakCount = sp->count;
+            sp->peakGeneration = generation;
+        }
+        ++k;
+    }
+}
+
+
+void Census::addOrganism(int start, int end, long long generation)
+{
+    // hash the sequence of numbers with the splitmix64 finaliser
+    std::uint64_t h = static_cast<std::uint64_t>(end - start + 1);
+    for (int i = start; i <= end; ++i) {
+        std::uint64_t z = h ^ static_cast<std::uint32_t>(mirror[i]);
+        z += 0x9e3779b97f4a7c15;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        h = z ^ (z >> 31);
+    }
+
+    auto [it, isNew] = species.try_emplace(h);
+    Species& sp = it->second;
+    if (isNew) {
+        sp.genome.assign(mirror.begin() + start, mirror.begin() + end + 1);
+        sp.firstSeen = generation;
+
+        // its parent is the species of the organism it overlaps most in the last generation
+        int bestOverlap = 0;
+        auto r = std::lower_bound(removed.begin(), removed.end(), start,
+            [](const auto& org, int s) { return org.second.end < s; });
+        for ( ; r != removed.end() && r->first <= end; ++r) {
+            int overlap = std::min(end, r->second.end) - std::max(start, r->first) + 1;
+            if (overlap > bestOverlap) {
+                bestOverlap = overlap;
+                sp.parent = r->second.species;
+            }
+        }
+    }
+
+    ++sp.count;
+    if (!sp.alive) {
+        sp.alive = true;
+        living.push_back(&sp);
+    }
+    organisms[start] = {end, h};
+}
+
+
+void Census::printReport(std::ostream& os, int minLength) const
+{
+    std::vector<const Species*> report;
+    for (const auto& [h, sp] : species) {
+        if (static_cast<int>(sp.genome.size()) >= minLength) {
+            report.push_back(&sp);
+        }
+    }
+    std::sort(report.begin(), report.end(), [](const Species* a, const Species* b) {
+        if (a->organismGenerations != b->organismGenerations) {
+            return a->organismGenerations > b->organismGenerations;
+        }
+        if (a->firstSeen != b->firstSeen) {
+            return a->firstSeen < b->firstSeen;
+        }
+        return a->genome < b->genome;
+    });
+
+    std::string out = "genome,length,first_seen,last_seen,peak_count,peak_generation,final_count,organism_generations,parent\n";
+    for (const Species* sp : report) {
+        auto parent = species.find(sp->parent);
+        std::format_to(std::back_inserter(out), "{},{},{},{},{},{},{},{},{}\n",
+            genomeString(sp->genome), sp->genome.size(), sp->firstSeen, sp->lastSeen, sp->peakCount,
+            sp->peakGeneration, sp->count, sp->organismGenerations,
+            (sp->parent != 0 && parent != species.end()) ? genomeString(parent->second.genome) : "");
+    }
+    os << out;
+}
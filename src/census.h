@@ -0,0 +1,86 @@
+// census.h
+//
+// Online detection of the symbioorganisms in a universe, and a census of
+// their species over a run.
+//
+// An organism is a maximal run of adjacent cells holding numbers (blanks and
+// X_MARKs separate organisms), and its species is the sequence of numbers it
+// holds, wherever in the world it lies: e.g. the 9,-11,1,-7 and 5,-11,1,-3
+// organisms of Figures 8-11. Each species is identified by a 64-bit hash of
+// its sequence.
+//
+// The census is updated incrementally. Each generation, only the cells that
+// changed (found from the non-blank cells of this generation and the last)
+// and their neighbours are examined: the organisms that touched them are
+// removed, and the organisms now covering them are found afresh, so the cost
+// per generation is proportional to the population rather than the size of
+// the world. When a species appears for the first time, the species of the
+// organism it overlaps most in the previous generation is recorded as its
+// parent, giving the lineage of each species.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+struct Species {
+    std::vector<int> genome;        // the numbers held by each of its organisms
+    std::uint64_t parent = 0;       // hash of the species it first appeared from (0 if none)
+    long long firstSeen = 0;        // generations in which it first and last appeared
+    long long lastSeen = 0;
+    long long count = 0;            // number of its organisms in the latest generation
+    long long peakCount = 0;        // the most organisms of it in one generation, and when
+    long long peakGeneration = 0;
+    long long organismGenerations = 0;  // total of count over all generations
+    bool alive = false;             // whether it is in the census's list of living species
+};
+
+class Census {
+public:
+    explicit Census(int worldSize);
+
+    // Report the universe's state in its current generation (to be called for
+    // each generation in turn)
+    void observe(const Universe& universe);
+
+    // As observe(), for a world state (e.g. one recorded by a CycleDetector)
+    // in the given generation
+    void observe(long long generation, const std::vector<int>& state);
+
+    const std::unordered_map<std::uint64_t, Species>& getSpecies() const { return species; }
+
+    // The number of organisms in the latest generation
+    long long getNumOrganisms() const { return static_cast<long long>(organisms.size()); }
+
+    // Write the census as CSV, one line per species of at least minLength
+    // cells, in decreasing order of organismGenerations
+    void printReport(std::ostream& os, int minLength = 1) const;
+
+private:
+    struct Organism {
+        int end;                  // last cell of the organism
+        std::uint64_t species;
+    };
+
+    void update(long long generation);
+    void addOrganism(int start, int end, long long generation);
+
+    int worldSize;
+    std::vector<int> mirror;                     // the world as of the latest generation
+    std::vector<int> nonBlank;                   // non-blank cells of mirror, in increasing order
+    std::vector<int> nextNonBlank;
+    std::vector<int> changed;                    // cells that changed this generation
+    std::map<int, Organism> organisms;           // organisms of mirror, by first cell
+    std::vector<std::pair<int, Organism>> removed;  // organisms of the last generation removed this generation
+    std::unordered_map<std::uint64_t, Species> species;
+    std::vector<Species*> living;                // species with organisms in the latest generation
+};
@@ -0,0 +1,424 @@
+// check.cpp
+//
+// Implementation of the differential check declared in check.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "check.h"
+#include "distributed.h"
+#include "scenarios.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <format> // from C++20
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// The reference: a plain implementation of the four norms, written directly
+// from the update procedures of the original program and sharing nothing
+// with the engine. The worlds are vectors of ints, every cell is visited in
+// every generation, each reproduction chain is followed hop by hop and the
+// nearest numbers are found by a linear search.
+class ReferenceWorld {
+public:
+    ReferenceWorld(int worldSize, Norm norm, const std::vector<int>& initState)
+        : worldSize(worldSize), norm(norm), world(worldSize, 0), nextWorld(worldSize, 0)
+    {
+        std::copy(initState.begin(), initState.end(), world.begin());
+    }
+
+    const std::vector<int>& state() const { return world; }
+
+    void step()
+    {
+        for (int i = 0; i < worldSize; ++i) {
+            switch (norm) {
+                case Norm::BASIC: {
+                    updateBasic(i);
+                    break;
+                }
+                case Norm::SYMBIOTIC: {
+                    if (world[i] != 0) {
+                        reproduceSymbiotic(i);
+                    }
+                    break;
+                }
+                case Norm::EXCLUSION:
+                case Norm::CONDITIONAL: {
+                    if (world[i] != 0 && world[i] != X_MARK) {
+                        reproduceExclusion(i);
+                    }
+                    break;
+                }
+            }
+        }
+        world.swap(nextWorld);
+        std::fill(nextWorld.begin(), nextWorld.end(), 0);
+    }
+
+private:
+    // Basic norm: the number in cell i is copied to cell i and to cell
+    // i+world[i]; a number arriving in an occupied cell is added to it, less
+    // the number in the cell above
+    void updateBasic(int i)
+    {
+        int x = (nextWorld[i] != 0) ? world[i] : 0;
+        nextWorld[i] += world[i] - x;
+        if (world[i] != 0) {
+            int c = i + world[i];
+            if (c >= 0 && c < worldSize) {
+                x = (nextWorld[c] != 0) ? world[c] : 0;
+                nextWorld[c] += world[i] - x;
+            }
+        }
+    }
+
+    // Symbiotic norm: the number in cell i is copied to cell j = i+world[i];
+    // if it lands below a different number n, it is copied on to i+n, and so on
+    void reproduceSymbiotic(int i)
+    {
+        int j = i + world[i];
+        for (int level = 1; level <= worldSize && j >= 0 && j < worldSize; ++level) {
+            nextWorld[j] = world[i];
+            if (world[j] == 0 || world[j] == world[i]) {
+                return;
+            }
+            j = i + world[j];
+        }
+    }
+
+    // Exclusion and conditional norms: as the symbiotic norm, but a number
+    // colliding with a different one leaves an X_MARK, or under the
+    // conditional norm, if it collides below a blank or an X_MARK, a mutation
+    void reproduceExclusion(int i)
+    {
+        int j = i + world[i];
+        for (int level = 1; level <= worldSize && j >= 0 && j < worldSize; ++level) {
+            if (nextWorld[j] == 0) {
+                nextWorld[j] = world[i];
+            }
+            else if (nextWorld[j] != world[i]) {
+                nextWorld[j] = (norm == Norm::CONDITIONAL) ? mutation(j) : X_MARK;
+            }
+            if (world[j] == 0 || world[j] == X_MARK || world[j] == world[i] || i + world[j] == j) {
+                return;
+            }
+            j = i + world[j];
+        }
+    }
+
+    // What a collision in cell j leaves under the conditional norm: an X_MARK
+    // below a number, otherwise the distance between the nearest numbers
+    // either side of cell j (an X_MARK if there is none on a side), negative
+    // if their signs differ
+    int mutation(int j) const
+    {
+        if (world[j] != 0 && world[j] != X_MARK) {
+            return X_MARK;
+        }
+        int left = nearestNumber(j, -1);
+        int right = nearestNumber(j, 1);
+        if (left < 0 || right < 0) {
+            return X_MARK;
+        }
+        return (right - left) * ((world[left] > 0) == (world[right] > 0) ? 1 : -1);
+    }
+
+    // The position of the nearest number to cell i in direction delta (1 or
+    // -1), or -1 if there is none before the edge of the world
+    int nearestNumber(int i, int delta) const
+    {
+        for (int pos = i + delta; pos >= 0 && pos < worldSize; pos += delta) {
+            if (world[pos] != 0 && world[pos] != X_MARK) {
+                return pos;
+            }
+        }
+        return -1;
+    }
+
+    int worldSize;
+    Norm norm;
+    std::vector<int> world;
+    std::vector<int> nextWorld;
+};
+
+// Write the current world of universe into out
+void readWorld(const Universe& universe, std::vector<std::int32_t>& out)
+{
+    std::fill(out.begin(), out.end(), 0);
+    universe.forEachNonBlank([&out](int i, int v) { out[i] = v; });
+}
+
+// Run case c on a universe, calling configure before each step with the
+// number of the step (from 0) to set up how it is computed
+void runUniverse(const CheckCase& c, const GenerationCallback& onGeneration,
+                 const std::function<void(Universe&, int)>& configure)
+{
+    Universe universe(c.worldSize, c.norm, c.initState);
+    std::vector<std::int32_t> world(c.worldSize);
+    for (int s = 0; s < c.numSteps; ++s) {
+        configure(universe, s);
+        universe.step();
+        readWorld(universe, world);
+        if (!onGeneration(world)) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+
+const std::vector<Engine>& getEngines()
+{
+    static const std::vector<Engine> engines = {
+        { "scalar", "dense, on one thread, with the scalar basic kernel", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe& u, int s) {
+                    if (s == 0) {
+                        u.setVectorised(false);
+                    }
+                });
+            } },
+        { "vectorised", "dense, on one thread, with the vectorised basic kernel for the CPU", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe&, int) {});
+            } },
+        { "sparse", "sparse execution, on one thread", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe& u, int s) {
+                    if (s == 0) {
+                        u.setSparse(true);
+                    }
+                });
+            } },
+        { "threads", "dense, on 4 threads", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe& u, int s) {
+                    if (s == 0) {
+                        u.setThreads(4);
+                    }
+                });
+            } },
+        { "sparse-threads", "sparse execution on 4 threads", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe& u, int s) {
+                    if (s == 0) {
+                        u.setSparse(true);
+                        u.setThreads(4);
+                    }
+                });
+            } },
+        { "instrumented", "dense, on one thread, updating the instrumentation counters", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe& u, int s) {
+                    if (s == 0) {
+                        u.setInstrumented(true);
+                    }
+                });
+            } },
+        { "switching", "switching between the modes above from one generation to the next", true,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                runUniverse(c, onGeneration, [](Universe& u, int s) {
+                    u.setSparse(s % 3 == 1);
+                    u.setThreads((s % 8 < 4) ? 1 : 3);
+                    u.setInstrumented(s % 5 == 2);
+                    u.setVectorised(s % 2 == 0);
+                });
+            } },
+        { "distributed", "split between 3 processes (fewer for tiny worlds; not checked by default, as it starts processes for every case)", false,
+            [](const CheckCase& c, const GenerationCallback& onGeneration) {
+                // the run cannot be stopped early, so just stop calling back
+                bool going = true;
+                runDistributed(c.worldSize, c.norm, c.initState, c.numSteps, std::min(3, c.worldSize),
+                    [&](std::span<const std::int32_t> world) {
+                        going = going && onGeneration(world);
+                    });
+            } },
+    };
+    return engines;
+}
+
+
+const Engine& getEngine(const std::string& name)
+{
+    for (const Engine& e : getEngines()) {
+        if (e.name == name) {
+            return e;
+        }
+    }
+    throw std::invalid_argument(std::format("Unknown engine {}", name));
+}
+
+
+CheckCase makeFigureCase(int fig, unsigned int seed)
+{
+    Scenario scenario = makeScenario(fig, seed);
+    return { std::format("figure {}", fig), -1, scenario.worldSize, scenario.norm, scenario.initState, scenario.numGens - 1 };
+}
+
+
+CheckCase makeFuzzCase(const FuzzOptions& options, long long index)
+{
+    std::seed_seq seq { options.seed, static_cast<unsigned int>(index), static_cast<unsigned int>(index >> 32) };
+    std::mt19937 rng { seq };
+    auto below = [&rng](int n) { return static_cast<int>(rng() % static_cast<unsigned int>(n)); };
+
+    CheckCase c;
+    c.name = std::format("fuzz case {}", index);
+    c.fuzzCase = index;
+    c.worldSize = 1 + below((index % 10 == 0) ? options.maxWorldSize : std::min(options.maxWorldSize, 150));
+    c.norm = static_cast<Norm>(below(4));
+    c.numSteps = 1 + below(options.maxSteps);
+
+    // mostly small numbers, which make long reproduction chains, but now and
+    // then ones reaching across much of the world, and a few too wide for
+    // the compact cell storage and a few X_MARKs
+    int maxValue = (below(5) == 0) ? 1 + below(2 * c.worldSize) : 1 + below(12);
+    double density = below(101) / 100.0;
+    std::bernoulli_distribution occupied { density };
+    int first = below(c.worldSize);
+    int last = first + below(c.worldSize - first);
+
+    c.initState.assign(c.worldSize, 0);
+    for (int i = first; i <= last; ++i) {
+        if (!occupied(rng)) {
+            continue;
+        }
+        int v = 1 + below(maxValue);
+        bool escaped = (below(200) == 0);
+        if constexpr (CELL_MAX < X_MARK - 1000) {
+            // a number too large for the compact codes
+            if (escaped) {
+                v = CELL_MAX + 1 + below(1000);
+            }
+        }
+        c.initState[i] = below(2) ? -v : v;
+        if (below(30) == 0) {
+            c.initState[i] = X_MARK;
+        }
+    }
+    return c;
+}
+
+
+std::optional<Divergence> checkCase(const Engine& engine, const CheckCase& c, long long& numGenerations)
+{
+    ReferenceWorld reference(c.worldSize, c.norm, c.initState);
+    std::optional<Divergence> divergence;
+    long long generation = 0;
+
+    engine.run(c, [&](std::span<const std::int32_t> world) {
+        reference.step();
+        ++generation;
+        const std::vector<int>& expected = reference.state();
+        if (world.size() != expected.size()) {
+            divergence = Divergence { c, engine.name, generation, -1, 0, 0 };
+            return false;
+        }
+        auto [e, g] = std::mismatch(expected.begin(), expected.end(), world.begin());
+        if (e != expected.end()) {
+            divergence = Divergence { c, engine.name, generation, static_cast<int>(e - expected.begin()), *e, *g };
+            return false;
+        }
+        return true;
+    });
+
+    numGenerations += generation;
+    if (!divergence && generation < c.numSteps) {
+        divergence = Divergence { c, engine.name, generation + 1, -1, 0, 0 };
+    }
+    return divergence;
+}
+
+
+CheckResult check(const CheckOptions& options)
+{
+    if (options.firstCase < 0 || options.numCases < 0) {
+        throw std::invalid_argument("The first fuzz case and number of fuzz cases must not be negative");
+    }
+    if (options.fuzz.maxWorldSize < 1 || options.fuzz.maxSteps < 1) {
+        throw std::invalid_argument("The largest world size and number of steps must be at least 1");
+    }
+
+    std::vector<const Engine*> engines;
+    if (options.engines.empty()) {
+        for (const Engine& e : getEngines()) {
+            if (e.byDefault) {
+                engines.push_back(&e);
+            }
+        }
+    }
+    else {
+        for (const std::string& name : options.engines) {
+            engines.push_back(&getEngine(name));
+        }
+    }
+
+    // the figures come first, then the fuzz cases
+    const long long numFigures = options.figures ? NUM_RULES : 0;
+    const long long numItems = numFigures + options.numCases;
+    auto makeCase = [&](long long t) {
+        return (t < numFigures) ? makeFigureCase(static_cast<int>(t) + 1, options.fuzz.seed)
+                                : makeFuzzCase(options.fuzz, options.firstCase + t - numFigures);
+    };
+
+    unsigned int numWorkers = options.numThreads ? options.numThreads
+                                                 : std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<long long> nextItem { 0 };
+    std::atomic<long long> failedItem { numItems };   // the first case known to diverge
+    CheckResult result;
+    std::exception_ptr error;
+    std::mutex resultMutex;
+
+    WorkStealingPool pool(numWorkers);
+    for (unsigned int w = 0; w < numWorkers; ++w) {
+        pool.submit([&]() {
+            long long numCases = 0;
+            long long numGenerations = 0;
+            try {
+                // the cases are claimed in order, so every case before one
+                // that diverges is still checked
+                for (long long t = nextItem++; t < numItems && t < failedItem; t = nextItem++) {
+                    CheckCase c = makeCase(t);
+                    for (const Engine* engine : engines) {
+                        if (std::optional<Divergence> d = checkCase(*engine, c, numGenerations)) {
+                            std::lock_guard<std::mutex> lock(resultMutex);
+                            if (t < failedItem) {
+                                failedItem = t;
+                                result.divergence = std::move(d);
+                            }
+                            break;
+                        }
+                    }
+                    ++numCases;
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failedItem = -1;
+            }
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+            result.numCases += numCases;
+            result.numGenerations += numGenerations;
+        });
+    }
+    pool.wait();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return result;
+}
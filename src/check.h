@@ -0,0 +1,108 @@
+// check.h
+//
+// A differential check of every way the engine has of computing a
+// generation (the plain dense scalar loop, sparse execution, threads, the
+// vectorised basic kernel, instrumentation, distributed stepping) against a
+// reference that shares no code with it: a naive stepper written directly
+// from the update procedures of the original program, on plain vectors of
+// ints, with a linear search for the nearest numbers of the mutation rule.
+// Every mode must give exactly the same worlds as the reference, down to the
+// order of the writes into each cell under the exclusion and conditional
+// norms, the handling of X_MARKs and the edge cases of the mutation rule.
+//
+// Each engine under test is run side by side with the reference on the
+// scenarios of the figures and on random ("fuzzed") worlds of every norm,
+// and their worlds compared after every generation. Fuzz case k of a check
+// is drawn from (seed, k), so a case that diverges can be rerun on its own.
+// The cases are checked in parallel, and the divergence reported is the
+// first one in case order whatever the number of threads.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// A world and the number of generations it is run for
+struct CheckCase {
+    std::string name;       // e.g. "figure 9" or "fuzz case 1234"
+    long long fuzzCase = -1;    // the number of a fuzz case (-1 for a figure)
+    int worldSize = 1;
+    Norm norm = Norm::BASIC;
+    std::vector<int> initState;
+    int numSteps = 0;
+};
+
+// Called with the world after each generation an engine computes. It returns
+// false to stop the run.
+using GenerationCallback = std::function<bool(std::span<const std::int32_t> world)>;
+
+// An engine under test: run runs a case, calling onGeneration after each step
+struct Engine {
+    std::string name;
+    std::string description;
+    bool byDefault;         // whether it is checked unless engines are named
+    std::function<void(const CheckCase& c, const GenerationCallback& onGeneration)> run;
+};
+
+// The engines that can be checked against the reference
+const std::vector<Engine>& getEngines();
+
+// The engine of the given name. Throws std::invalid_argument if there is none.
+const Engine& getEngine(const std::string& name);
+
+// The case of the given figure (1-22) or test case (23-NUM_RULES), whose
+// initial state is drawn from seed if it is random
+CheckCase makeFigureCase(int fig, unsigned int seed);
+
+struct FuzzOptions {
+    unsigned int seed = 0;
+    int maxWorldSize = 2000;    // of every tenth case; the others are at most 150 cells
+    int maxSteps = 50;
+};
+
+// Fuzz case index of a check with the given options
+CheckCase makeFuzzCase(const FuzzOptions& options, long long index);
+
+// Where an engine's worlds first differ from the reference's
+struct Divergence {
+    CheckCase checkCase;
+    std::string engine;
+    long long generation = 0;   // the first generation that differs
+    int cell = -1;              // the first cell that differs, or -1 if the engine stopped short
+    int expected = 0;           // the reference's value of the cell
+    int got = 0;                // the engine's
+};
+
+// Run engine on case c side by side with the reference, returning the first
+// divergence, if any, and adding the number of generations compared to
+// numGenerations
+std::optional<Divergence> checkCase(const Engine& engine, const CheckCase& c, long long& numGenerations);
+
+struct CheckOptions {
+    std::vector<std::string> engines;   // empty => those checked by default
+    bool figures = true;                // whether the figures are checked, before the fuzz cases
+    FuzzOptions fuzz;
+    long long firstCase = 0;            // the first fuzz case checked
+    long long numCases = 10000;         // the number of fuzz cases
+    unsigned int numThreads = 0;        // 0 => one per hardware thread
+};
+
+struct CheckResult {
+    long long numCases = 0;             // cases checked (figures included)
+    long long numGenerations = 0;       // generations compared over all engines
+    std::optional<Divergence> divergence;
+};
+
+// Run a check, stopping at the first case on which an engine diverges.
+// Throws std::invalid_argument for invalid options.
+CheckResult check(const CheckOptions& options);
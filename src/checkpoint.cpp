@@ -0,0 +1,212 @@
+// checkpoint.cpp
+//
+// Implementation of the checkpoints declared in checkpoint.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "checkpoint.h"
+#include "encoding.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <format> // from C++20
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'B','5','4','C','H','K','P','T'};
+const std::uint32_t CHECKPOINT_VERSION = 2;    // version 1 has no last row
+
+// Write data to filename and force it to disk before returning
+void writeFileAndSync(const std::string& filename, const std::string& data)
+{
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(std::format("Unable to open checkpoint file {}: {}", filename, std::strerror(errno)));
+    }
+    const char* p = data.data();
+    std::size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error(std::format("Error writing checkpoint file {}: {}", filename, std::strerror(err)));
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    if (::fsync(fd) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error(std::format("Error writing checkpoint file {}: {}", filename, std::strerror(err)));
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error(std::format("Error writing checkpoint file {}: {}", filename, std::strerror(errno)));
+    }
+}
+
+// Force the entries of the directory holding filename (e.g. a rename into
+// it) to disk
+void syncDirectoryOf(const std::string& filename)
+{
+    std::filesystem::path dir = std::filesystem::path(filename).parent_path();
+    if (dir.empty()) {
+        dir = ".";
+    }
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::format("Unable to open directory {}: {}", dir.string(), std::strerror(errno)));
+    }
+    int rc = ::fsync(fd);
+    int err = errno;
+    ::close(fd);
+    if (rc != 0) {
+        throw std::runtime_error(std::format("Unable to sync directory {}: {}", dir.string(), std::strerror(err)));
+    }
+}
+
+} // namespace
+
+
+Universe Checkpoint::makeUniverse() const
+{
+    Universe universe(static_cast<int>(state.size()), norm, state);
+    universe.setGeneration(generation);
+    return universe;
+}
+
+
+void writeCheckpoint(const std::string& filename, const CheckpointInfo& info,
+                     Norm norm, long long generation, const CellBuffer& world,
+                     const CellBuffer* lastRow)
+{
+    std::string data(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    putFixed(data, CHECKPOINT_VERSION, 4);
+    putFixed(data, static_cast<std::uint32_t>(info.fig), 4);
+    putFixed(data, static_cast<std::uint32_t>(info.numGens), 4);
+    putFixed(data, info.randomInit ? 1 : 0, 4);
+    putFixed(data, info.seed, 4);
+    putFixed(data, static_cast<std::uint32_t>(norm), 4);
+    putFixed(data, static_cast<std::uint32_t>(world.size()), 4);
+    putFixed(data, static_cast<std::uint64_t>(generation), 8);
+    putRuns(data, world.size(), [&](int i) { return world.get(i); });
+    putFixed(data, lastRow ? 1 : 0, 4);
+    if (lastRow) {
+        putRuns(data, world.size(), [&](int i) { return lastRow->get(i); });
+    }
+
+    // write the whole checkpoint to a temporary file and sync it to disk,
+    // then rename it over the old one and sync the directory, so that a
+    // complete checkpoint survives however the program stops, even in a
+    // system crash or power failure
+    std::string tmpname = filename + ".tmp";
+    writeFileAndSync(tmpname, data);
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error(std::format("Unable to rename {} to {}", tmpname, filename));
+    }
+    syncDirectoryOf(filename);
+}
+
+
+Checkpoint readCheckpoint(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("Unable to open checkpoint file {}", filename));
+    }
+    std::string data { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    const unsigned char* begin = reinterpret_cast<const unsigned char*>(data.data());
+    ByteDecoder in(begin, begin + data.size());
+    if (data.size() < sizeof(CHECKPOINT_MAGIC) || std::memcmp(begin, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        throw std::runtime_error(std::format("{} is not a checkpoint file", filename));
+    }
+    in.getFixed(sizeof(CHECKPOINT_MAGIC));
+
+    try {
+        std::uint32_t version = static_cast<std::uint32_t>(in.getFixed(4));
+        if (version < 1 || version > CHECKPOINT_VERSION) {
+            throw std::runtime_error(std::format("unsupported version {}", version));
+        }
+
+        Checkpoint cp;
+        cp.info.fig = static_cast<int>(in.getFixed(4));
+        cp.info.numGens = static_cast<int>(in.getFixed(4));
+        cp.info.randomInit = (in.getFixed(4) & 1) != 0;
+        cp.info.seed = static_cast<unsigned int>(in.getFixed(4));
+        cp.norm = static_cast<Norm>(in.getFixed(4));
+        int worldSize = static_cast<int>(in.getFixed(4));
+        cp.generation = static_cast<long long>(in.getFixed(8));
+        if (worldSize < 1 || cp.generation < 0) {
+            throw std::runtime_error("bad world size or generation");
+        }
+        getNormName(cp.norm); // throws for an unknown norm
+
+        cp.state.resize(worldSize);
+        in.getRuns(worldSize, [&](int b, int e, int v) {
+            std::fill(cp.state.begin() + b, cp.state.begin() + e, v);
+        });
+        if (version >= 2 && (in.getFixed(4) & 1) != 0) {
+            cp.lastRow.resize(worldSize);
+            in.getRuns(worldSize, [&](int b, int e, int v) {
+                std::fill(cp.lastRow.begin() + b, cp.lastRow.begin() + e, v);
+            });
+        }
+        if (in.position() != begin + data.size()) {
+            throw std::runtime_error("unexpected data after the world");
+        }
+        return cp;
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error(std::format("Corrupt checkpoint file {} ({})", filename, e.what()));
+    }
+}
+
+
+Checkpointer::Checkpointer(const std::string& filename, const CheckpointInfo& info)
+    : filename(filename), info(info)
+{
+}
+
+
+Checkpointer::~Checkpointer()
+{
+    if (pending.valid()) {
+        pending.wait();
+    }
+}
+
+
+void Checkpointer::save(const Universe& universe, const CellBuffer* lastRow)
+{
+    wait();
+
+    // only the copies of the worlds are made on the calling thread
+    pending = std::async(std::launch::async,
+        [this, norm = universe.getNorm(), generation = universe.getGeneration(), world = universe.cells(),
+         row = lastRow ? std::optional<CellBuffer>(*lastRow) : std::nullopt]() {
+            writeCheckpoint(filename, info, norm, generation, world, row ? &*row : nullptr);
+        });
+}
+
+
+void Checkpointer::wait()
+{
+    if (pending.valid()) {
+        pending.get();
+    }
+}
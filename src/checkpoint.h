@@ -0,0 +1,89 @@
+// checkpoint.h
+//
+// Checkpoints of a running universe, from which a long run can be resumed
+// after it has been stopped or killed.
+//
+// A checkpoint file holds the magic bytes "B54CHKPT", the format version,
+// the metadata of the run (see CheckpointInfo), the norm, the generation
+// counter and the world itself, run-length encoded as in the keyframes of a
+// trace (see trace.h), followed (since version 2) by the last row of output
+// written by the run if it wrote only the rows that changed (-u), encoded in
+// the same way. The engine keeps no random number generator state
+// while it runs: a random initial state is drawn from the scenario seed
+// before the first generation, and the seed is recorded with the checkpoint.
+//
+// A checkpoint is written to a temporary file, which is synced to disk and
+// then renamed over the checkpoint file (and the rename synced too), so the
+// file always holds a complete checkpoint even if the program is killed or
+// the system crashes part way through writing one.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+// The metadata of the run a checkpoint was taken from
+struct CheckpointInfo {
+    int fig = 0;                  // figure/test case number (0 if none)
+    int numGens = 0;              // number of generations the run was set up for
+    bool randomInit = false;      // true if the initial state was generated from seed
+    unsigned int seed = 0;
+};
+
+struct Checkpoint {
+    CheckpointInfo info;
+    Norm norm = Norm::BASIC;
+    long long generation = 0;
+    std::vector<int> state;
+    std::vector<int> lastRow;     // the last row of output written (empty if not recorded)
+
+    // A universe in the checkpointed state, at the checkpointed generation
+    Universe makeUniverse() const;
+};
+
+// Write a checkpoint of world (the state of a universe with the given norm
+// in the given generation) and of lastRow (if not null) to filename,
+// atomically. Throws std::runtime_error if the file cannot be written.
+void writeCheckpoint(const std::string& filename, const CheckpointInfo& info,
+                     Norm norm, long long generation, const CellBuffer& world,
+                     const CellBuffer* lastRow = nullptr);
+
+// Read the checkpoint in filename. Throws std::runtime_error if the file
+// cannot be read or is not a valid checkpoint.
+Checkpoint readCheckpoint(const std::string& filename);
+
+
+// Writes checkpoints of a universe on a background thread. save() only
+// copies the world (in its compact storage) before returning, so the run
+// carries on while the checkpoint is encoded and written.
+class Checkpointer {
+public:
+    Checkpointer(const std::string& filename, const CheckpointInfo& info);
+
+    // Waits for any checkpoint still being written (ignoring errors)
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // Start writing a checkpoint of the current state of universe, and of
+    // the last row of output written (if not null). If the previous
+    // checkpoint is still being written, waits for it to finish first.
+    void save(const Universe& universe, const CellBuffer* lastRow = nullptr);
+
+    // Wait until the last checkpoint has been written. Rethrows any error
+    // from writing it.
+    void wait();
+
+private:
+    std::string filename;
+    CheckpointInfo info;
+    std::future<void> pending;
+};
@@ -0,0 +1,109 @@
+// counters.cpp
+//
+// Implementation of the instrumentation counters declared in counters.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "counters.h"
+
+#include <algorithm>
+#include <format> // from C++20
+#include <iterator>
+#include <ostream>
+#include <string>
+
+namespace {
+
+// Append the non-empty bins of a histogram to out, one per line
+void formatHistogram(std::string& out, const std::array<long long, COUNTER_BINS>& hist)
+{
+    long long total = 0;
+    for (long long n : hist) {
+        total += n;
+    }
+    for (int b = 0; b < COUNTER_BINS; ++b) {
+        if (hist[b] == 0) {
+            continue;
+        }
+        long long lo = 1LL << b;
+        std::string range = (b == COUNTER_BINS - 1) ? std::format("{}+", lo)
+                          : (b == 0) ? std::string("1")
+                          : std::format("{}-{}", lo, 2 * lo - 1);
+        std::format_to(std::back_inserter(out), "  {:>18} {:>16} {:>6.2f}%\n",
+            range, hist[b], 100.0 * hist[b] / total);
+    }
+}
+
+} // namespace
+
+
+void Counters::addCounts(const Counters& other)
+{
+    for (int b = 0; b < COUNTER_BINS; ++b) {
+        chainLength[b] += other.chainLength[b];
+        findDistance[b] += other.findDistance[b];
+    }
+    findMisses += other.findMisses;
+    writes += other.writes;
+    collisions += other.collisions;
+    xMarks += other.xMarks;
+    mutations += other.mutations;
+}
+
+
+void Counters::merge(const Counters& other)
+{
+    addCounts(other);
+    if (other.generations > 0) {
+        minSeconds = (generations > 0) ? std::min(minSeconds, other.minSeconds) : other.minSeconds;
+        maxSeconds = std::max(maxSeconds, other.maxSeconds);
+    }
+    generations += other.generations;
+    seconds += other.seconds;
+}
+
+
+void printCounters(std::ostream& os, const Counters& counters)
+{
+    std::string out;
+    auto line = [&](const char* label, long long n) {
+        std::format_to(std::back_inserter(out), "{:<32} {:>16}\n", label, n);
+    };
+
+    line("generations", counters.generations);
+    if (counters.generations > 0) {
+        std::format_to(std::back_inserter(out), "{:<32} {:>16.6f}\n", "total time (s)", counters.seconds);
+        std::format_to(std::back_inserter(out), "{:<32} {:>16.3f} (min {:.3f}, max {:.3f})\n",
+            "time per generation (us)", 1e6 * counters.seconds / counters.generations,
+            1e6 * counters.minSeconds, 1e6 * counters.maxSeconds);
+    }
+    line("writes", counters.writes);
+    line("collisions", counters.collisions);
+    line("X_MARKs written", counters.xMarks);
+    line("mutations", counters.mutations);
+
+    long long numChains = 0;
+    for (long long n : counters.chainLength) {
+        numChains += n;
+    }
+    line("reproduction chains", numChains);
+    if (numChains > 0) {
+        out += "level reached by each chain:\n";
+        formatHistogram(out, counters.chainLength);
+    }
+
+    long long numFound = 0;
+    for (long long n : counters.findDistance) {
+        numFound += n;
+    }
+    line("nearest-number searches", numFound + counters.findMisses);
+    line("  reaching the edge", counters.findMisses);
+    if (numFound > 0) {
+        out += "distance to the nearest number:\n";
+        formatHistogram(out, counters.findDistance);
+    }
+
+    os << out;
+}
@@ -0,0 +1,70 @@
+// counters.h
+//
+// Instrumentation of the hot paths of the simulation engine: counts of what
+// the norms do in each generation (the lengths of reproduction chains, the
+// collisions, exclusion marks and mutations they make, and how far the
+// conditional norm scans for the nearest numbers), and the wall time of each
+// generation.
+//
+// The generation loop of a Universe is compiled twice, once with each of the
+// instrumentation policies below, and the counters are only updated by the
+// Counted version, chosen with Universe::setInstrumented(). Every update of
+// a counter is discarded at compile time from the Uncounted version, so a
+// universe that is not instrumented pays nothing for them.
+//
+// Within a universe, each chunk of the world (see Universe::setThreads()) has
+// its own counters, so they are only ever updated by the thread computing
+// that chunk. They are summed into the universe's totals at the end of each
+// generation; the totals of several universes can be combined with merge().
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <iosfwd>
+
+// The instrumentation policies
+struct Uncounted {
+    static constexpr bool enabled = false;
+};
+
+struct Counted {
+    static constexpr bool enabled = true;
+};
+
+// Histogram bins are powers of two: bin k counts the values in [2^k, 2^(k+1)),
+// and the last bin everything from 2^(COUNTER_BINS-1) up
+const int COUNTER_BINS = 24;
+
+struct Counters {
+    std::array<long long, COUNTER_BINS> chainLength {};  // level (hops) reached by each reproduction chain
+    std::array<long long, COUNTER_BINS> findDistance {}; // distance to each number found by findNearestNumber
+    long long findMisses = 0;     // searches that reached the edge of the world without finding a number
+    long long writes = 0;         // writes into the next generation
+    long long collisions = 0;     // writes into a cell already written in the next generation
+    long long xMarks = 0;         // X_MARKs written (by the exclusion and conditional norms)
+    long long mutations = 0;      // numbers placed by the conditional norm's mutation rule
+    long long generations = 0;    // generations computed
+    double seconds = 0.0;         // total, shortest and longest wall time of a generation
+    double minSeconds = 0.0;
+    double maxSeconds = 0.0;
+
+    static int bin(long long value)
+    {
+        int b = value > 0 ? std::bit_width(static_cast<unsigned long long>(value)) - 1 : 0;
+        return b < COUNTER_BINS ? b : COUNTER_BINS - 1;
+    }
+
+    // Add other's counts to these (excluding the generation times)
+    void addCounts(const Counters& other);
+
+    // Add all of other's counters to these
+    void merge(const Counters& other);
+};
+
+// Write a report of the counters in human-readable form
+void printCounters(std::ostream& os, const Counters& counters);
@@ -0,0 +1,130 @@
+// cycles.cpp
+//
+// Implementation of the cycle detector declared in cycles.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "cycles.h"
+
+#include <algorithm>
+#include <format> // from C++20
+#include <stdexcept>
+
+
+CycleDetector::CycleDetector(std::size_t maxRecordCells, std::size_t maxHistory)
+    : maxRecordCells(maxRecordCells), maxHistory(maxHistory)
+{
+}
+
+
+bool CycleDetector::observe(const Universe& universe)
+{
+    if (found()) {
+        return true;
+    }
+
+    long long g = universe.getGeneration();
+
+    if (candidateStart >= 0) {
+        if (g < candidateStart + candidatePeriod) {
+            // part way through the candidate cycle: record its states if we can
+            if (recording) {
+                recorded.push_back(universe.state());
+                recordedMutations.push_back(universe.getMutations());
+            }
+        }
+        else if (universe.state() == recorded[0]) {
+            start = candidateStart;
+            period = candidatePeriod;
+            if (period > 1) {
+                kind = CycleKind::PERIODIC;
+            }
+            else if (std::all_of(recorded[0].begin(), recorded[0].end(), [](int v) { return v == 0; })) {
+                kind = CycleKind::EXTINCT;
+            }
+            else {
+                kind = CycleKind::FIXED_POINT;
+            }
+            history.clear();
+            return true;
+        }
+        else {
+            // the hashes matched but the states did not recur
+            candidateStart = -1;
+            recorded.clear();
+            recordedMutations.clear();
+        }
+    }
+
+    // the hashes of the generations of a candidate cycle are kept too, so
+    // that another cycle can be found as soon as it turns out to be false
+    std::uint64_t h = universe.stateHash();
+    auto it = history.find(h);
+    if (it != history.end() && candidateStart < 0) {
+        // generation g may repeat generation it->second: check whether its
+        // own state recurs the same number of generations later
+        candidateStart = g;
+        candidatePeriod = g - it->second;
+        recording = (candidatePeriod * universe.size() <= static_cast<long long>(maxRecordCells));
+        recorded.clear();
+        recorded.push_back(universe.state());
+        recordedMutations.clear();
+        recordedMutations.push_back(universe.getMutations());
+    }
+
+    if (history.size() >= maxHistory) {
+        history.clear();
+    }
+    history[h] = g;
+    return false;
+}
+
+
+const std::vector<int>& CycleDetector::stateAt(long long g) const
+{
+    if (!hasStates() || g < start) {
+        throw std::out_of_range(std::format("No recorded state for generation {}", g));
+    }
+    return recorded[(g - start) % period];
+}
+
+
+long long CycleDetector::mutationsAt(long long g) const
+{
+    if (!hasStates() || g < start) {
+        throw std::out_of_range(std::format("No recorded state for generation {}", g));
+    }
+    return recordedMutations[(g - start) % period];
+}
+
+
+std::string CycleDetector::describe() const
+{
+    switch (kind) {
+        case CycleKind::NONE: return "no cycle";
+        case CycleKind::EXTINCT: return std::format("extinct from generation {}", start);
+        case CycleKind::FIXED_POINT: return std::format("fixed point from generation {}", start);
+        case CycleKind::PERIODIC: return std::format("cycle of period {} from generation {}", period, start);
+        default: {
+            throw std::logic_error(std::format("Encountered unknown cycle kind {}", (int)kind));
+        }
+    }
+}
+
+
+void fastForward(Universe& universe, const CycleDetector& detector, long long target)
+{
+    long long g = universe.getGeneration();
+    if (!detector.found() || g < detector.getStart() || target < g) {
+        throw std::invalid_argument(std::format("Cannot fast-forward from generation {} to {}", g, target));
+    }
+
+    // generation target has the same state as this many generations from now
+    long long steps = (target - g) % detector.getPeriod();
+    for (long long n = 0; n < steps; ++n) {
+        universe.step();
+    }
+    universe.setGeneration(target);
+}
@@ -0,0 +1,84 @@
+// cycles.h
+//
+// Detection of universes whose dynamics have settled: the world has gone
+// blank (extinction), stopped changing (a fixed point), or started to repeat
+// itself with some period k. As every norm is deterministic, once the state
+// of generation g recurs in generation g+k, generation N >= g has the same
+// state as generation g + (N-g) mod k, so the rest of a run can be skipped.
+//
+// The detector keeps the hash of each generation (see Universe::stateHash()).
+// When the hash of generation g matches that of an earlier generation g-k,
+// the state of generation g is saved and the following k generations are
+// recorded; the cycle is confirmed only if generation g+k then has exactly
+// the same state, so a hash collision can never produce a wrong result.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class CycleKind {
+    NONE,           // no cycle found (yet)
+    EXTINCT,        // the world is blank
+    FIXED_POINT,    // the world no longer changes
+    PERIODIC        // the world repeats itself with a period of more than one generation
+};
+
+class CycleDetector {
+public:
+    // The states of a candidate cycle are only recorded if the period times
+    // the world size is at most maxRecordCells; the hashes of at most
+    // maxHistory generations are kept (the oldest are forgotten when full).
+    explicit CycleDetector(std::size_t maxRecordCells = std::size_t(1) << 24,
+                           std::size_t maxHistory = std::size_t(1) << 20);
+
+    // Report the universe's state in its current generation (to be called for
+    // each generation in turn). Returns true once a cycle has been confirmed.
+    bool observe(const Universe& universe);
+
+    CycleKind getKind() const { return kind; }
+    bool found() const { return kind != CycleKind::NONE; }
+
+    // The generation from which the cycle has been confirmed, and its period
+    long long getStart() const { return start; }
+    long long getPeriod() const { return period; }
+
+    // Whether the states of a whole period of the confirmed cycle were
+    // recorded, and if so the state of any generation g >= getStart()
+    bool hasStates() const { return found() && recorded.size() == static_cast<std::size_t>(period); }
+    const std::vector<int>& stateAt(long long g) const;
+
+    // The number of mutations made in computing generation g, as stateAt()
+    long long mutationsAt(long long g) const;
+
+    // A description of a confirmed cycle, e.g. "cycle of period 5 from generation 12"
+    std::string describe() const;
+
+private:
+    std::size_t maxRecordCells;
+    std::size_t maxHistory;
+    std::unordered_map<std::uint64_t, long long> history;  // hash -> latest generation with it
+    long long candidateStart = -1;       // generation whose state is being checked for recurrence
+    long long candidatePeriod = 0;
+    bool recording = false;              // whether the candidate's states are all being recorded
+    std::vector<std::vector<int>> recorded;  // states of generations candidateStart ...
+    std::vector<long long> recordedMutations; // ... and their mutation counts
+    CycleKind kind = CycleKind::NONE;
+    long long start = 0;
+    long long period = 0;
+};
+
+// Advance universe (in which detector has confirmed a cycle) to generation
+// target, stepping it at most period-1 times, e.g. to skip the generations of
+// a cycle too large for its states to be recorded that are not written. Throws std::invalid_argument if
+// no cycle has been confirmed or target is before the universe's generation.
+void fastForward(Universe& universe, const CycleDetector& detector, long long target);
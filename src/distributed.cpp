@@ -0,0 +1,489 @@
+// distributed.cpp
+//
+// Implementation of the distributed stepping declared in distributed.h.
+//
+// In each generation the launching process and the ranks meet at a barrier
+// three times:
+//   1. once every rank has set the cells it needs from beyond its shard, so
+//      that the shared world can be overwritten;
+//   2. inside Universe::stepShard(), once every rank has posted the writes
+//      from its shard into others to its outbox;
+//   3. once every rank has written its new shard into the shared world.
+// Between barriers 3 and 1 the launching process hands the world to the
+// caller, while the ranks read the cells they need from it.
+//
+// A rank that fails records its error and aborts the barrier, which makes
+// the other ranks and the launching process give up too.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "distributed.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <format> // from C++20
+#include <stdexcept>
+#include <string>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// An array in memory shared with the processes forked after it is created.
+// Its elements start zeroed, so T must be a type for which that is valid.
+template <typename T>
+class SharedArray {
+public:
+    explicit SharedArray(std::size_t n) : n(n)
+    {
+        void* p = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error(std::format("Unable to map {} bytes of shared memory: {}",
+                bytes(), std::strerror(errno)));
+        }
+        data = static_cast<T*>(p);
+    }
+
+    ~SharedArray() { munmap(data, bytes()); }
+
+    SharedArray(const SharedArray&) = delete;
+    SharedArray& operator=(const SharedArray&) = delete;
+
+    T& operator[](std::size_t i) { return data[i]; }
+    const T& operator[](std::size_t i) const { return data[i]; }
+    T* get() { return data; }
+
+private:
+    std::size_t bytes() const { return std::max<std::size_t>(n, 1) * sizeof(T); }
+
+    std::size_t n;
+    T* data;
+};
+
+// A barrier across processes that can be aborted, releasing everyone waiting
+// at it (and anyone arriving later) with a failure
+struct Control {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int parties;
+    int waiting;
+    unsigned long phase;
+    bool aborted;
+    char error[256];
+};
+
+// What a rank tells the others about its shard of the current world
+struct ShardSummary {
+    int maxMagnitude;   // the largest magnitude of any number (X_MARK excluded)
+    bool hasXMark;      // whether it holds an X_MARK
+    int firstNumber;    // the position of its first number, or -1 if it has none
+    int lastNumber;     // the position of its last number, or -1 if it has none
+};
+
+// Thrown in a rank to unwind it when another rank has failed
+struct RunAborted {};
+
+bool isNumber(int v)
+{
+    return v != 0 && v != X_MARK;
+}
+
+// The state shared by the launching process and the ranks
+struct Shared {
+    Shared(int worldSize, int numRanks)
+        : worldSize(worldSize), numRanks(numRanks),
+          outboxCapacity(std::max<std::size_t>(65536, static_cast<std::size_t>(worldSize))),
+          control(1), summaries(numRanks), world(worldSize), outboxSizes(numRanks),
+          outboxes(outboxCapacity * numRanks)
+    {
+        for (int r = 0; r < numRanks; ++r) {
+            shards.push_back(getShard(worldSize, numRanks, r));
+        }
+
+        Control& c = control[0];
+        pthread_mutexattr_t mutexAttr;
+        pthread_mutexattr_init(&mutexAttr);
+        pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&c.mutex, &mutexAttr);
+        pthread_mutexattr_destroy(&mutexAttr);
+        pthread_condattr_t condAttr;
+        pthread_condattr_init(&condAttr);
+        pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+        pthread_cond_init(&c.cond, &condAttr);
+        pthread_condattr_destroy(&condAttr);
+        c.parties = numRanks + 1;
+    }
+
+    ~Shared()
+    {
+        pthread_cond_destroy(&control[0].cond);
+        pthread_mutex_destroy(&control[0].mutex);
+    }
+
+    // Wait at the barrier until all parties have arrived, returning false if
+    // the run is aborted. If given, failed is called every so often while
+    // waiting, and the run aborted with its message if it returns one.
+    bool arrive(const std::function<std::string()>& failed = {})
+    {
+        Control& c = control[0];
+        pthread_mutex_lock(&c.mutex);
+        if (!c.aborted && ++c.waiting == c.parties) {
+            c.waiting = 0;
+            ++c.phase;
+            pthread_cond_broadcast(&c.cond);
+        }
+        else {
+            unsigned long phase = c.phase;
+            while (c.phase == phase && !c.aborted) {
+                if (!failed) {
+                    pthread_cond_wait(&c.cond, &c.mutex);
+                    continue;
+                }
+                timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_nsec += 100000000;
+                if (deadline.tv_nsec >= 1000000000) {
+                    deadline.tv_nsec -= 1000000000;
+                    ++deadline.tv_sec;
+                }
+                if (pthread_cond_timedwait(&c.cond, &c.mutex, &deadline) == ETIMEDOUT) {
+                    pthread_mutex_unlock(&c.mutex);
+                    std::string message = failed();
+                    if (!message.empty()) {
+                        abort(message);
+                    }
+                    pthread_mutex_lock(&c.mutex);
+                }
+            }
+        }
+        bool ok = !c.aborted;
+        pthread_mutex_unlock(&c.mutex);
+        return ok;
+    }
+
+    // Abort the run, recording the message if it is the first error
+    void abort(const std::string& message)
+    {
+        Control& c = control[0];
+        pthread_mutex_lock(&c.mutex);
+        if (!c.aborted) {
+            c.aborted = true;
+            std::snprintf(c.error, sizeof(c.error), "%s", message.c_str());
+        }
+        pthread_cond_broadcast(&c.cond);
+        pthread_mutex_unlock(&c.mutex);
+    }
+
+    // The rank whose shard holds cell i
+    int rankOf(int i) const
+    {
+        auto it = std::upper_bound(shards.begin(), shards.end(), i,
+            [](int i, const std::pair<int, int>& shard) { return i < shard.first; });
+        return static_cast<int>(it - shards.begin()) - 1;
+    }
+
+    // The position of the nearest number of the world to the left of cell
+    // pos, or -1 if there is none
+    int nearestNumberBefore(int pos) const
+    {
+        for (int q = (pos > 0) ? rankOf(pos - 1) : -1; q >= 0; --q) {
+            const ShardSummary& s = summaries[q];
+            if (s.firstNumber < 0 || s.firstNumber >= pos) {
+                continue;
+            }
+            if (s.lastNumber < pos) {
+                return s.lastNumber;
+            }
+            for (int j = pos - 1; ; --j) {
+                if (isNumber(world[j])) {
+                    return j;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // The position of the nearest number of the world at or to the right of
+    // cell pos, or -1 if there is none
+    int nearestNumberFrom(int pos) const
+    {
+        for (int q = (pos < worldSize) ? rankOf(pos) : numRanks; q < numRanks; ++q) {
+            const ShardSummary& s = summaries[q];
+            if (s.lastNumber < pos) {
+                continue;
+            }
+            if (s.firstNumber >= pos) {
+                return s.firstNumber;
+            }
+            for (int j = pos; ; ++j) {
+                if (isNumber(world[j])) {
+                    return j;
+                }
+            }
+        }
+        return -1;
+    }
+
+    int worldSize;
+    int numRanks;
+    std::size_t outboxCapacity;               // writes each rank can post in one generation
+    std::vector<std::pair<int, int>> shards;  // [begin, end) of each rank's shard
+    SharedArray<Control> control;
+    SharedArray<ShardSummary> summaries;      // of each rank's shard of the current world
+    SharedArray<std::int32_t> world;          // the current world
+    SharedArray<std::size_t> outboxSizes;
+    SharedArray<CellWrite> outboxes;          // [r*outboxCapacity + k]: k-th write from rank r's shard
+};
+
+// The exchange of a rank's writes with the others through their outboxes
+class SharedMemoryLink : public ShardLink {
+public:
+    SharedMemoryLink(Shared& shared, int rank) : shared(shared), rank(rank) {}
+
+    void exchange(std::span<const CellWrite> outgoing) override
+    {
+        if (outgoing.size() > shared.outboxCapacity) {
+            throw std::runtime_error(std::format("Rank {} made {} writes into other shards in one generation (at most {} can be exchanged)",
+                rank, outgoing.size(), shared.outboxCapacity));
+        }
+        std::copy(outgoing.begin(), outgoing.end(), &shared.outboxes[rank * shared.outboxCapacity]);
+        shared.outboxSizes[rank] = outgoing.size();
+
+        if (!shared.arrive()) {
+            throw RunAborted {};
+        }
+
+        auto [begin, end] = shared.shards[rank];
+        lower.clear();
+        higher.clear();
+        for (int q = 0; q < shared.numRanks; ++q) {
+            if (q == rank) {
+                continue;
+            }
+            const CellWrite* box = &shared.outboxes[q * shared.outboxCapacity];
+            std::vector<CellWrite>& into = (q < rank) ? lower : higher;
+            for (std::size_t k = 0; k < shared.outboxSizes[q]; ++k) {
+                if (box[k].j >= begin && box[k].j < end) {
+                    into.push_back(box[k]);
+                }
+            }
+        }
+    }
+
+    std::span<const CellWrite> fromLower() const override { return lower; }
+    std::span<const CellWrite> fromHigher() const override { return higher; }
+
+private:
+    Shared& shared;
+    int rank;
+    std::vector<CellWrite> lower;
+    std::vector<CellWrite> higher;
+};
+
+// Write the shard of universe into the shared world, blanking the cells that
+// the rank wrote there last time (held in published, which is updated), and
+// summarise it for the other ranks
+void publishShard(Shared& shared, int rank, const Universe& universe, std::vector<int>& published)
+{
+    for (int i : published) {
+        shared.world[i] = 0;
+    }
+    published.clear();
+
+    // outside its shard, the rank's world is blank after a step
+    ShardSummary s { 0, false, -1, -1 };
+    universe.forEachNonBlank([&](int i, int v) {
+        shared.world[i] = v;
+        published.push_back(i);
+        if (v == X_MARK) {
+            s.hasXMark = true;
+        }
+        else {
+            s.maxMagnitude = std::max(s.maxMagnitude, std::abs(v));
+            if (s.firstNumber < 0) {
+                s.firstNumber = i;
+            }
+            s.lastNumber = i;
+        }
+    });
+    shared.summaries[rank] = s;
+}
+
+// Set the cells of universe that the next step of the rank's shard may read
+// from beyond it, from the shared world
+void importNeighbourhood(const Shared& shared, int rank, Universe& universe)
+{
+    // only the symbiotic norm (in which an X_MARK can only come from the
+    // initial state) follows a chain through an X_MARK, as if a number
+    bool xMarksReach = (universe.getNorm() == Norm::SYMBIOTIC);
+    int reach = 0;
+    for (int q = 0; q < shared.numRanks; ++q) {
+        const ShardSummary& s = shared.summaries[q];
+        reach = std::max(reach, (xMarksReach && s.hasXMark) ? std::max(s.maxMagnitude, X_MARK) : s.maxMagnitude);
+    }
+    reach = std::min(reach, shared.worldSize);
+
+    auto [begin, end] = shared.shards[rank];
+    int from = std::max(0, begin - reach);
+    int to = std::min(shared.worldSize, end + reach);
+    auto import = [&](int i) {
+        if (shared.world[i] != 0) {
+            universe.setCell(i, shared.world[i]);
+        }
+    };
+    for (int i = from; i < begin; ++i) {
+        import(i);
+    }
+    for (int i = end; i < to; ++i) {
+        import(i);
+    }
+
+    // the mutations of the conditional norm depend on the nearest numbers
+    // either side of a cell, however far away
+    if (universe.getNorm() == Norm::CONDITIONAL) {
+        if (int left = shared.nearestNumberBefore(from); left >= 0) {
+            import(left);
+        }
+        if (int right = shared.nearestNumberFrom(to); right >= 0) {
+            import(right);
+        }
+    }
+}
+
+// The body of a rank's process
+void runRank(Shared& shared, int rank, Norm norm, long long numSteps)
+{
+    auto [begin, end] = shared.shards[rank];
+    Universe universe(shared.worldSize, norm);
+    universe.setSparse(true);
+    SharedMemoryLink link(shared, rank);
+
+    std::vector<int> published;
+    for (int i = begin; i < end; ++i) {
+        if (shared.world[i] != 0) {
+            universe.setCell(i, shared.world[i]);
+        }
+    }
+    publishShard(shared, rank, universe, published);
+    if (!shared.arrive()) {
+        throw RunAborted {};
+    }
+
+    for (long long g = 0; g < numSteps; ++g) {
+        importNeighbourhood(shared, rank, universe);
+        if (!shared.arrive()) {
+            throw RunAborted {};
+        }
+        universe.stepShard(begin, end, link);
+        publishShard(shared, rank, universe, published);
+        if (!shared.arrive()) {
+            throw RunAborted {};
+        }
+    }
+}
+
+} // namespace
+
+
+std::pair<int, int> getShard(int worldSize, int numRanks, int r)
+{
+    if (numRanks < 1 || numRanks > worldSize) {
+        throw std::invalid_argument(std::format("Number of ranks ({}) must be between 1 and the world size ({})",
+            numRanks, worldSize));
+    }
+    if (r < 0 || r >= numRanks) {
+        throw std::invalid_argument(std::format("Rank {} is not between 0 and {}", r, numRanks - 1));
+    }
+    long long size = worldSize;
+    return {static_cast<int>(size * r / numRanks), static_cast<int>(size * (r + 1) / numRanks)};
+}
+
+
+void runDistributed(int worldSize, Norm norm, const std::vector<int>& initState, long long numSteps, int numRanks,
+                    const std::function<void(std::span<const std::int32_t> world)>& onGeneration)
+{
+    if (worldSize < 1) {
+        throw std::invalid_argument(std::format("World size ({}) must be at least 1", worldSize));
+    }
+    if (initState.size() > static_cast<std::size_t>(worldSize)) {
+        throw std::invalid_argument(std::format("Initializer list size ({}) is bigger than world size ({})",
+            initState.size(), worldSize));
+    }
+    if (numSteps < 0) {
+        throw std::invalid_argument(std::format("Number of steps ({}) must not be negative", numSteps));
+    }
+
+    Shared shared(worldSize, numRanks);
+    std::copy(initState.begin(), initState.end(), shared.world.get());
+
+    std::vector<pid_t> ranks;
+    for (int r = 0; r < numRanks; ++r) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int rc = 0;
+            try {
+                runRank(shared, r, norm, numSteps);
+            }
+            catch (const RunAborted&) {
+                rc = 1;
+            }
+            catch (const std::exception& e) {
+                shared.abort(e.what());
+                rc = 1;
+            }
+            _exit(rc);
+        }
+        if (pid < 0) {
+            shared.abort(std::format("Unable to start rank {}: {}", r, std::strerror(errno)));
+            break;
+        }
+        ranks.push_back(pid);
+    }
+
+    // a rank that dies without aborting the run (e.g. killed by a signal)
+    // would leave everyone else waiting for it
+    auto rankDied = [&]() -> std::string {
+        for (pid_t& pid : ranks) {
+            int status;
+            if (pid > 0 && waitpid(pid, &status, WNOHANG) == pid) {
+                pid = 0;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    return "A rank terminated unexpectedly";
+                }
+            }
+        }
+        return {};
+    };
+
+    std::string error;
+    try {
+        bool ok = shared.arrive(rankDied);
+        for (long long g = 0; ok && g < numSteps; ++g) {
+            ok = shared.arrive(rankDied) && shared.arrive(rankDied) && shared.arrive(rankDied);
+            if (ok && onGeneration) {
+                onGeneration(std::span<const std::int32_t>(shared.world.get(), worldSize));
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        shared.abort(e.what());
+    }
+
+    for (pid_t pid : ranks) {
+        if (pid > 0) {
+            waitpid(pid, nullptr, 0);
+        }
+    }
+    if (shared.control[0].aborted) {
+        throw std::runtime_error(shared.control[0].error);
+    }
+}
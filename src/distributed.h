@@ -0,0 +1,46 @@
+// distributed.h
+//
+// Distributed stepping of a single universe, for worlds too large for the
+// memory bandwidth of one process. The world is split into shards, one per
+// rank, and each rank computes the generations of its own shard with
+// Universe::stepShard(). In each generation the ranks exchange only the
+// writes that the reproductions from their shards make into other shards,
+// and then the cells each needs from beyond its shard: those within reach
+// of its reproductions (within the largest magnitude of any number in the
+// world) and, under the conditional norm, the nearest numbers beyond them.
+// The result is identical to the serial one.
+//
+// The launcher here runs the ranks as processes forked on the local machine,
+// which exchange the writes and cells through shared memory and keep in step
+// with a process-shared barrier. Each rank holds a sparse universe of the
+// full world size in which only its shard and the cells around it are ever
+// non-blank, so its work scales with the population of its shard. The
+// ranks' exchange is behind the ShardLink interface (see universe.h), so a
+// message passing transport between machines could be put in its place.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// The shard [begin, end) of rank r of numRanks in a world of worldSize
+// cells, which is split as evenly as possible. Throws std::invalid_argument
+// if the world has fewer cells than there are ranks.
+std::pair<int, int> getShard(int worldSize, int numRanks, int r);
+
+// Run a universe of worldSize cells under the given norm, whose first cells
+// are set from initState, for numSteps generations on numRanks processes,
+// calling onGeneration (if provided) in the calling process with the world
+// after each generation. Throws std::invalid_argument for invalid arguments,
+// and std::runtime_error if a rank fails.
+void runDistributed(int worldSize, Norm norm, const std::vector<int>& initState, long long numSteps, int numRanks,
+                    const std::function<void(std::span<const std::int32_t> world)>& onGeneration = {});
@@ -0,0 +1,133 @@
+// encoding.h
+//
+// Helpers for the binary files written by barricelli54 (traces and
+// checkpoints): little-endian fixed-size integers, LEB128 varints (zigzag
+// encoded for signed values, so numbers of small magnitude take few bytes
+// whatever their sign), and run-length encoding of a whole world as
+// (value, run length) pairs.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+inline void putFixed(std::string& out, std::uint64_t v, int numBytes)
+{
+    for (int b = 0; b < numBytes; ++b) {
+        out.push_back(static_cast<char>((v >> (8 * b)) & 0xff));
+    }
+}
+
+inline std::uint64_t getFixed(const unsigned char* p, int numBytes)
+{
+    std::uint64_t v = 0;
+    for (int b = 0; b < numBytes; ++b) {
+        v |= std::uint64_t(p[b]) << (8 * b);
+    }
+    return v;
+}
+
+inline void putVarint(std::string& out, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline void putSigned(std::string& out, int v)
+{
+    std::uint32_t u = static_cast<std::uint32_t>(v);
+    putVarint(out, (u << 1) ^ static_cast<std::uint32_t>(v >> 31));
+}
+
+// Append the n cells get(0) ... get(n-1) to out as (value, run length) pairs
+template <typename Get>
+void putRuns(std::string& out, int n, Get&& get)
+{
+    int i = 0;
+    while (i < n) {
+        int v = get(i);
+        int run = 1;
+        while (i + run < n && get(i + run) == v) {
+            ++run;
+        }
+        putSigned(out, v);
+        putVarint(out, run);
+        i += run;
+    }
+}
+
+
+// Reads the encoded values from a block of bytes, throwing
+// std::runtime_error if they run past its end
+class ByteDecoder {
+public:
+    ByteDecoder(const unsigned char* p, const unsigned char* end) : p(p), end(end) {}
+
+    std::uint64_t getVarint()
+    {
+        std::uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            unsigned char byte = static_cast<unsigned char>(getByte());
+            v |= std::uint64_t(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return v;
+            }
+        }
+        throw std::runtime_error("Malformed number in encoded data");
+    }
+
+    int getSigned()
+    {
+        std::uint32_t u = static_cast<std::uint32_t>(getVarint());
+        return static_cast<int>((u >> 1) ^ (~(u & 1) + 1));
+    }
+
+    char getByte()
+    {
+        if (p == end) {
+            throw std::runtime_error("Encoded data runs past the end of the file");
+        }
+        return static_cast<char>(*p++);
+    }
+
+    std::uint64_t getFixed(int numBytes)
+    {
+        if (end - p < numBytes) {
+            throw std::runtime_error("Encoded data runs past the end of the file");
+        }
+        std::uint64_t v = ::getFixed(p, numBytes);
+        p += numBytes;
+        return v;
+    }
+
+    // Read n cells written by putRuns(), calling set(begin, end, value) for each run
+    template <typename Set>
+    void getRuns(int n, Set&& set)
+    {
+        int i = 0;
+        while (i < n) {
+            int v = getSigned();
+            std::uint64_t run = getVarint();
+            if (run == 0 || run > static_cast<std::uint64_t>(n - i)) {
+                throw std::runtime_error("Malformed run length in encoded data");
+            }
+            set(i, i + static_cast<int>(run), v);
+            i += static_cast<int>(run);
+        }
+    }
+
+    const unsigned char* position() const { return p; }
+
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+};
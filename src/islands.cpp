@@ -0,0 +1,232 @@
+// islands.cpp
+//
+// Implementation of the island model declared in islands.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "islands.h"
+#include "random_state.h"
+
+#include <atomic>
+#include <climits>
+#include <exception>
+#include <format> // from C++20
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+const int LEFT = 0;
+const int RIGHT = 1;
+
+// Thrown on an island's thread to unwind it when another island has failed
+struct RunAborted {};
+
+// What an island hands to its neighbours. Migrations (epochs) are numbered
+// from 1, and the segments of epoch e are in slot e % 2.
+struct alignas(64) Mailbox {
+    std::atomic<long long> published { 0 };        // the last epoch whose segments are here
+    std::atomic<long long> consumed[2] { 0, 0 };   // the last epoch taken by the neighbour on each side
+    std::vector<int> segments[2][2];               // [side][slot]: the island's boundary segments
+};
+
+class Archipelago {
+public:
+    explicit Archipelago(const IslandOptions& options)
+        : options(options), mailboxes(std::make_unique<Mailbox[]>(options.numIslands))
+    {
+        for (int i = 0; i < options.numIslands; ++i) {
+            for (auto& side : mailboxes[i].segments) {
+                for (std::vector<int>& slot : side) {
+                    slot.assign(options.segmentLength, 0);
+                }
+            }
+        }
+    }
+
+    // Run the given island on the calling thread, returning its final state
+    std::vector<int> runIsland(int island, const IslandCallback& onGeneration)
+    {
+        Universe universe(options.worldSize, options.norm, makeIslandState(options, island));
+        universe.setSparse(options.sparse);
+        if (onGeneration) {
+            onGeneration(island, universe);
+        }
+        for (int g = 1; g < options.numGens; ++g) {
+            universe.step();
+            if (g % options.migrationInterval == 0) {
+                migrate(island, universe, g / options.migrationInterval);
+            }
+            if (onGeneration) {
+                onGeneration(island, universe);
+            }
+        }
+        return universe.state();
+    }
+
+    // Release every island waiting for another, making it give up
+    void abort()
+    {
+        aborted = true;
+        for (int i = 0; i < options.numIslands; ++i) {
+            Mailbox& m = mailboxes[i];
+            m.published = LLONG_MAX;
+            m.published.notify_all();
+            for (std::atomic<long long>& c : m.consumed) {
+                c = LLONG_MAX;
+                c.notify_all();
+            }
+        }
+    }
+
+private:
+    // The island across the given side of island i, or -1 if there is none
+    int neighbour(int i, int side) const
+    {
+        int n = (side == LEFT) ? i - 1 : i + 1;
+        if (options.topology == Topology::RING) {
+            return (n + options.numIslands) % options.numIslands;
+        }
+        return (n >= 0 && n < options.numIslands) ? n : -1;
+    }
+
+    // The first cell of the boundary segment on the given side
+    int segmentStart(int side) const
+    {
+        return (side == LEFT) ? 0 : options.worldSize - options.segmentLength;
+    }
+
+    // Wait until counter has reached at least value (abort() sets every
+    // counter to its maximum to release the waiters)
+    void waitFor(std::atomic<long long>& counter, long long value)
+    {
+        for (long long v = counter.load(std::memory_order_acquire); v < value && !aborted;
+             v = counter.load(std::memory_order_acquire)) {
+            counter.wait(v, std::memory_order_acquire);
+        }
+        if (aborted) {
+            throw RunAborted {};
+        }
+    }
+
+    // Swap the boundary segments of island (whose universe is given) with
+    // those of its neighbours, at the given epoch
+    void migrate(int island, Universe& universe, long long epoch)
+    {
+        Mailbox& mine = mailboxes[island];
+        int slot = static_cast<int>(epoch % 2);
+
+        // post the outgoing segments, once the neighbours have taken the
+        // ones last posted in the same slot
+        for (int side : { LEFT, RIGHT }) {
+            if (neighbour(island, side) < 0) {
+                continue;
+            }
+            waitFor(mine.consumed[side], epoch - 2);
+            std::vector<int>& segment = mine.segments[side][slot];
+            int start = segmentStart(side);
+            for (int k = 0; k < options.segmentLength; ++k) {
+                segment[k] = universe.cell(start + k);
+            }
+        }
+        mine.published.store(epoch, std::memory_order_release);
+        mine.published.notify_all();
+
+        // take the neighbours' segments facing this island
+        for (int side : { LEFT, RIGHT }) {
+            int n = neighbour(island, side);
+            if (n < 0) {
+                continue;
+            }
+            Mailbox& theirs = mailboxes[n];
+            waitFor(theirs.published, epoch);
+            const std::vector<int>& segment = theirs.segments[1 - side][slot];
+            int start = segmentStart(side);
+            for (int k = 0; k < options.segmentLength; ++k) {
+                universe.setCell(start + k, segment[k]);
+            }
+            theirs.consumed[1 - side].store(epoch, std::memory_order_release);
+            theirs.consumed[1 - side].notify_all();
+        }
+    }
+
+    const IslandOptions& options;
+    std::unique_ptr<Mailbox[]> mailboxes;
+    std::atomic<bool> aborted { false };
+};
+
+} // namespace
+
+
+std::vector<int> makeIslandState(const IslandOptions& options, int island)
+{
+    return makeRandomState((options.initLength > 0) ? options.initLength : options.worldSize,
+        RandomStateOptions { options.seed, static_cast<unsigned long long>(island), options.density, options.maxValue });
+}
+
+
+std::vector<std::vector<int>> runIslands(const IslandOptions& options, const IslandCallback& onGeneration)
+{
+    if (options.numIslands < 1 || options.worldSize < 1 || options.numGens < 1 || options.migrationInterval < 1) {
+        throw std::invalid_argument("Number of islands, world size, generations and migration interval must be at least 1");
+    }
+    if (options.segmentLength < 1 || 2 * options.segmentLength > options.worldSize) {
+        throw std::invalid_argument(std::format("Segment length ({}) must be between 1 and half the world size ({})",
+            options.segmentLength, options.worldSize));
+    }
+    if (options.initLength < 0 || options.initLength > options.worldSize) {
+        throw std::invalid_argument(std::format("Initial state length ({}) must be between 0 and the world size ({})",
+            options.initLength, options.worldSize));
+    }
+    if (options.maxValue < 1 || options.maxValue >= X_MARK) {
+        throw std::invalid_argument(std::format("Largest initial value ({}) must be between 1 and {}",
+            options.maxValue, X_MARK - 1));
+    }
+    if (!(options.density > 0.0 && options.density <= 1.0)) {
+        throw std::invalid_argument(std::format("Initial density ({}) must be in (0, 1]", options.density));
+    }
+
+    Archipelago archipelago(options);
+    std::vector<std::vector<int>> finalStates(options.numIslands);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) {
+            error = e;
+        }
+        archipelago.abort();
+    };
+
+    // each island has a thread of its own, as it may wait for its neighbours
+    std::vector<std::thread> threads;
+    try {
+        for (int i = 0; i < options.numIslands; ++i) {
+            threads.emplace_back([&, i]() {
+                try {
+                    finalStates[i] = archipelago.runIsland(i, onGeneration);
+                }
+                catch (const RunAborted&) {
+                }
+                catch (...) {
+                    fail(std::current_exception());
+                }
+            });
+        }
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return finalStates;
+}
@@ -0,0 +1,62 @@
+// islands.h
+//
+// An island model of evolution: many medium-sized universes ("islands") run
+// concurrently, each on a thread of its own, and every k generations they
+// exchange organisms across their boundaries. Island i's right-hand boundary
+// segment (its last few cells) is swapped with the left-hand boundary
+// segment of the next island, so that what drifts off the edge of one world
+// carries on in its neighbour's. The islands form a ring (the last one is
+// followed by the first) or a line (the outer edges of the end islands are
+// left alone).
+//
+// The islands hand their migrant segments to each other without locks:
+// each publishes its outgoing segments into a double-buffered mailbox and
+// bumps an atomic epoch counter, and its neighbours wait on that counter
+// before taking them (and acknowledge them with one of their own), so an
+// island can run up to one migration ahead of its neighbours. Every island
+// sees exactly the same migrants whatever the scheduling, so the result of
+// a run depends only on its options (including the seed and the topology).
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <functional>
+#include <vector>
+
+enum class Topology {
+    RING,
+    LINE
+};
+
+struct IslandOptions {
+    int numIslands = 8;
+    int worldSize = 1000;          // of each island
+    Norm norm = Norm::SYMBIOTIC;
+    int numGens = 1000;            // generations each island is run for (including the first)
+    int migrationInterval = 50;    // generations between migrations
+    int segmentLength = 20;        // cells swapped across each boundary at a migration
+    Topology topology = Topology::RING;
+    int initLength = 0;            // cells at the start of each island given random values (0 => all)
+    int maxValue = 10;             // magnitude of the largest number in an initial state
+    double density = 0.5;          // chance of each of those cells holding a number
+    unsigned int seed = 0;
+    bool sparse = false;
+};
+
+// The initial state of the given island, drawn from (seed, island) (see
+// random_state.h)
+std::vector<int> makeIslandState(const IslandOptions& options, int island);
+
+// Called on an island's thread with its universe at the start of the run
+// and after each generation (at a migration, once the migrants have arrived)
+using IslandCallback = std::function<void(int island, const Universe& universe)>;
+
+// Run the islands, returning the final state of each. Throws
+// std::invalid_argument for invalid options, and rethrows the first
+// exception thrown on an island's thread (e.g. by onGeneration).
+std::vector<std::vector<int>> runIslands(const IslandOptions& options, const IslandCallback& onGeneration = {});
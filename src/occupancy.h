@@ -0,0 +1,184 @@
+// occupancy.h
+//
+// A bit-packed map of which cells of a world hold a number (i.e. are neither
+// blank nor an exclusion mark), used to find the nearest number to the left
+// or right of any cell in constant time, and to visit just the occupied cells
+// of a sparse world in index order.
+//
+// Besides one bit per cell, the map keeps for each 64-cell word the index of
+// the nearest non-empty word before and after it, so a lookup inspects at most
+// two words however sparse the world is, and a traversal skips straight over
+// empty stretches. The whole structure costs about two bits per cell.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "cell.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+class OccupancyMap {
+public:
+    OccupancyMap() = default;
+    explicit OccupancyMap(std::pmr::memory_resource* memory) : bits(memory), prevWord(memory), nextWord(memory) {}
+
+    // Rebuild the map from the current contents of world. If includeX is true,
+    // exclusion marks count as occupied too (i.e. the map holds all non-blank cells).
+    void build(const CellBuffer& world, bool includeX = false)
+    {
+        resize(world.size());
+        fillWords(world, 0, numWords(), includeX);
+        linkWords();
+    }
+
+    // As build(), but only the cells whose bits are set in candidates are
+    // examined; every other cell of world is known to be blank
+    void buildFrom(const CellBuffer& world, const std::pmr::vector<std::uint64_t>& candidates, bool includeX = false)
+    {
+        resize(world.size());
+        fillWordsFrom(world, candidates, 0, numWords(), includeX);
+        linkWords();
+    }
+
+    // The pieces of build() and buildFrom(), for building a map in parallel:
+    // resize() the map, then fill disjoint ranges of words [wBegin, wEnd) on
+    // different threads, then linkWords() once they are all done
+    void resize(int n)
+    {
+        numCells = n;
+        bits.resize((n + 63) / 64);
+    }
+
+    int numWords() const { return static_cast<int>(bits.size()); }
+
+    void fillWords(const CellBuffer& world, int wBegin, int wEnd, bool includeX)
+    {
+        for (int w = wBegin; w < wEnd; ++w) {
+            std::uint64_t word = 0;
+            int end = std::min(numCells, (w + 1) << 6);
+            for (int i = w << 6; i < end; ++i) {
+                if (includeX ? !world.isBlank(i) : world.isNumber(i)) {
+                    word |= std::uint64_t(1) << (i & 63);
+                }
+            }
+            bits[w] = word;
+        }
+    }
+
+    void fillWordsFrom(const CellBuffer& world, const std::pmr::vector<std::uint64_t>& candidates,
+                       int wBegin, int wEnd, bool includeX)
+    {
+        for (int w = wBegin; w < wEnd; ++w) {
+            std::uint64_t word = 0;
+            for (std::uint64_t c = candidates[w]; c != 0; c &= c - 1) {
+                int i = (w << 6) + std::countr_zero(c);
+                if (includeX ? !world.isBlank(i) : world.isNumber(i)) {
+                    word |= std::uint64_t(1) << (i & 63);
+                }
+            }
+            bits[w] = word;
+        }
+    }
+
+    // Fill in the nearest non-empty word before and after each word
+    void linkWords()
+    {
+        int n = numWords();
+        prevWord.resize(n);
+        nextWord.resize(n);
+
+        int last = -1;
+        for (int w = 0; w < n; ++w) {
+            prevWord[w] = last;
+            if (bits[w] != 0) {
+                last = w;
+            }
+        }
+        last = -1;
+        for (int w = n - 1; w >= 0; --w) {
+            nextWord[w] = last;
+            if (bits[w] != 0) {
+                last = w;
+            }
+        }
+    }
+
+    // Call f(i) for each occupied cell i, in increasing order of i
+    template <typename F>
+    void forEach(F&& f) const
+    {
+        forEachInWords(0, numWords(), f);
+    }
+
+    // Call f(i) for each occupied cell i in words [wBegin, wEnd) (i.e. cells
+    // [64*wBegin, 64*wEnd)), in increasing order of i
+    template <typename F>
+    void forEachInWords(int wBegin, int wEnd, F&& f) const
+    {
+        if (wBegin >= wEnd) {
+            return;
+        }
+        int w = (bits[wBegin] != 0) ? wBegin : nextWord[wBegin];
+        while (w >= 0 && w < wEnd) {
+            for (std::uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                f((w << 6) + std::countr_zero(word));
+            }
+            w = nextWord[w];
+        }
+    }
+
+    // Position of the nearest number strictly to the left of cell i, or -1 if none
+    int nearestLeft(int i) const
+    {
+        if (i <= 0) {
+            return -1;
+        }
+        int w = (i - 1) >> 6;
+        std::uint64_t word = bits[w] & lowMask(((i - 1) & 63) + 1);
+        if (word == 0) {
+            w = prevWord[w];
+            if (w < 0) {
+                return -1;
+            }
+            word = bits[w];
+        }
+        return (w << 6) + 63 - std::countl_zero(word);
+    }
+
+    // Position of the nearest number strictly to the right of cell i, or -1 if none
+    int nearestRight(int i) const
+    {
+        if (i + 1 >= numCells) {
+            return -1;
+        }
+        int w = (i + 1) >> 6;
+        std::uint64_t word = bits[w] & ~lowMask((i + 1) & 63);
+        if (word == 0) {
+            w = nextWord[w];
+            if (w < 0) {
+                return -1;
+            }
+            word = bits[w];
+        }
+        return (w << 6) + std::countr_zero(word);
+    }
+
+private:
+    // A mask of the lowest n bits of a word (0 <= n <= 64)
+    static std::uint64_t lowMask(int n)
+    {
+        return (n >= 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << n) - 1);
+    }
+
+    int numCells = 0;
+    std::pmr::vector<std::uint64_t> bits;
+    std::pmr::vector<int> prevWord;   // nearest non-empty word strictly before each word, or -1
+    std::pmr::vector<int> nextWord;   // nearest non-empty word strictly after each word, or -1
+};
@@ -0,0 +1,155 @@
+// random_state.cpp
+//
+// The counter-based generator of random initial states (see random_state.h).
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "random_state.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <format> // from C++20
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define B54_X86_KERNELS 1
+#endif
+
+namespace {
+
+const std::uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;   // the increment of SplitMix64
+
+// Cells filled by each task of a parallel fill
+const long long CHUNK_CELLS = 1 << 16;
+
+// The output function of SplitMix64
+inline std::uint64_t mix64(std::uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// What a fill needs to turn a counter into a cell value
+struct Params {
+    std::uint64_t key;          // the SplitMix64 state before the first cell of the run
+    std::uint64_t threshold;    // a cell holds a number if the top 32 bits of its output are below this
+    std::uint64_t maxValue;
+};
+
+Params makeParams(const RandomStateOptions& options)
+{
+    if (!(options.density >= 0.0 && options.density <= 1.0)) {
+        throw std::invalid_argument(std::format("Density ({}) must be in [0, 1]", options.density));
+    }
+    if (options.maxValue < 1 || options.maxValue >= X_MARK) {
+        throw std::invalid_argument(std::format("Largest random value ({}) must be between 1 and {}",
+            options.maxValue, X_MARK - 1));
+    }
+    Params p;
+    p.key = mix64(mix64(options.seed + GOLDEN_GAMMA) ^ options.run);
+    p.threshold = static_cast<std::uint64_t>(options.density * 4294967296.0);
+    p.maxValue = static_cast<std::uint64_t>(options.maxValue);
+    return p;
+}
+
+// The value of the cell whose SplitMix64 output is h: bit 0 gives the sign,
+// bits 1-31 the magnitude and bits 32-63 whether there is a number at all
+inline int cellValue(std::uint64_t h, const Params& p)
+{
+    int magnitude = 1 + static_cast<int>((((h & 0xFFFFFFFFull) >> 1) * p.maxValue) >> 31);
+    int v = (h & 1) ? -magnitude : magnitude;
+    return ((h >> 32) < p.threshold) ? v : 0;
+}
+
+// Fill out[0..n) with cells first.. of a run. The loop has no branches and
+// no state carried between cells, so the compiler vectorises it (with
+// AVX2, whose lanes can do the 64-bit multiplications).
+[[gnu::always_inline]] inline void fillRange(int* out, long long n, std::uint64_t first, const Params& p)
+{
+    std::uint64_t z = p.key + (first + 1) * GOLDEN_GAMMA;
+    for (long long k = 0; k < n; ++k) {
+        out[k] = cellValue(mix64(z + static_cast<std::uint64_t>(k) * GOLDEN_GAMMA), p);
+    }
+}
+
+#pragma GCC push_options
+#pragma GCC optimize("tree-vectorize")
+
+void fillRangeDefault(int* out, long long n, std::uint64_t first, const Params& p)
+{
+    fillRange(out, n, first, p);
+}
+
+#ifdef B54_X86_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2")
+void fillRangeAvx2(int* out, long long n, std::uint64_t first, const Params& p)
+{
+    fillRange(out, n, first, p);
+}
+#pragma GCC pop_options
+#endif // B54_X86_KERNELS
+
+#pragma GCC pop_options
+
+using FillFunction = void (*)(int* out, long long n, std::uint64_t first, const Params& p);
+
+// The fastest fill supported by the CPU we are running on
+FillFunction selectFill()
+{
+#ifdef B54_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return fillRangeAvx2;
+    }
+#endif
+    return fillRangeDefault;
+}
+
+} // namespace
+
+
+int randomCell(const RandomStateOptions& options, long long index)
+{
+    Params p = makeParams(options);
+    return cellValue(mix64(p.key + (static_cast<std::uint64_t>(index) + 1) * GOLDEN_GAMMA), p);
+}
+
+
+void fillRandomState(std::span<int> state, const RandomStateOptions& options, long long firstIndex,
+    unsigned int numThreads)
+{
+    static const FillFunction fill = selectFill();
+    Params p = makeParams(options);
+
+    long long n = static_cast<long long>(state.size());
+    long long numChunks = (n + CHUNK_CELLS - 1) / CHUNK_CELLS;
+    if (numThreads == 1 || numChunks < 2) {
+        fill(state.data(), n, static_cast<std::uint64_t>(firstIndex), p);
+        return;
+    }
+
+    // every cell is independent of the others, so the chunks may be filled
+    // in any order
+    WorkStealingPool pool(numThreads);
+    pool.forEachIndex(static_cast<int>(numChunks), [&](int c) {
+        long long begin = c * CHUNK_CELLS;
+        long long end = std::min(n, begin + CHUNK_CELLS);
+        fill(state.data() + begin, end - begin, static_cast<std::uint64_t>(firstIndex + begin), p);
+    });
+}
+
+
+std::vector<int> makeRandomState(int length, const RandomStateOptions& options, unsigned int numThreads)
+{
+    if (length < 0) {
+        throw std::invalid_argument(std::format("Random state length ({}) must not be negative", length));
+    }
+    std::vector<int> state(length);
+    fillRandomState(state, options, 0, numThreads);
+    return state;
+}
@@ -0,0 +1,47 @@
+// random_state.h
+//
+// Reproducible random initial states, drawn from a counter-based generator:
+// the value of each cell is a pure function of (seed, run, index), where run
+// tells apart the replicates, candidates or islands drawn from one seed. No
+// generator state is carried from one cell to the next, so a state of any
+// size can be filled in parallel, in any order, a block of cells at a time
+// with vector instructions, and any cell of any run can be regenerated on its
+// own with randomCell().
+//
+// Cell index of a run is output index+1 of a SplitMix64 stream whose state
+// starts at a key mixed from the seed and the run. A cell holds a number with
+// the given probability (the density), whose magnitude is uniform in
+// 1..maxValue and whose sign is positive or negative with equal chances. With
+// the defaults (a density of 0.5 and a maxValue of 1) this is the tossing of
+// two coins of Barricelli's Figure 15: -1 25% of the time, 0 50% and 1 25%.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <span>
+#include <vector>
+
+struct RandomStateOptions {
+    unsigned int seed = 0;
+    unsigned long long run = 0;    // e.g. the replicate, candidate or island drawn from the seed
+    double density = 0.5;          // chance of each cell holding a number
+    int maxValue = 1;              // magnitude of the largest number
+};
+
+// The value of the given cell of a random state. Throws std::invalid_argument
+// for invalid options.
+int randomCell(const RandomStateOptions& options, long long index);
+
+// Fill state with cells firstIndex, firstIndex+1, ... of a random state, on
+// numThreads threads (0 => one per hardware thread). Throws
+// std::invalid_argument for invalid options.
+void fillRandomState(std::span<int> state, const RandomStateOptions& options, long long firstIndex = 0,
+    unsigned int numThreads = 1);
+
+// The first length cells of a random state
+std::vector<int> makeRandomState(int length, const RandomStateOptions& options, unsigned int numThreads = 1);
@@ -0,0 +1,552 @@
+// render.cpp
+//
+// Implementation of the image rendering declared in render.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "render.h"
+#include "universe.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <format> // from C++20
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+// A 5x8 bitmap font for the printable ASCII characters (from ' ' to '~').
+// Each glyph is 8 rows from the top, each row 5 bits with the leftmost
+// pixel in bit 4; rows 0-6 are above the baseline, and row 7 holds
+// descenders.
+const int GLYPH_WIDTH = 5;
+const int GLYPH_HEIGHT = 8;
+const std::uint8_t FONT[95][GLYPH_HEIGHT] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, //  
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00 }, // !
+    { 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a, 0x00 }, // #
+    { 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04, 0x00 }, // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03, 0x00 }, // %
+    { 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d, 0x00 }, // &
+    { 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x00 }, // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00 }, // )
+    { 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00, 0x00 }, // *
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x08 }, // ,
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00 }, // .
+    { 0x01, 0x02, 0x02, 0x04, 0x08, 0x08, 0x10, 0x00 }, // /
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e, 0x00 }, // 0
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e, 0x00 }, // 1
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f, 0x00 }, // 2
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e, 0x00 }, // 3
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02, 0x00 }, // 4
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e, 0x00 }, // 5
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e, 0x00 }, // 6
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00 }, // 7
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e, 0x00 }, // 8
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c, 0x00 }, // 9
+    { 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x00, 0x00 }, // :
+    { 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x08 }, // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00 }, // <
+    { 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00, 0x00 }, // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00 }, // >
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04, 0x00 }, // ?
+    { 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e, 0x00 }, // @
+    { 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11, 0x00 }, // A
+    { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e, 0x00 }, // B
+    { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e, 0x00 }, // C
+    { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c, 0x00 }, // D
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f, 0x00 }, // E
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10, 0x00 }, // F
+    { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f, 0x00 }, // G
+    { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11, 0x00 }, // H
+    { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e, 0x00 }, // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c, 0x00 }, // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11, 0x00 }, // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f, 0x00 }, // L
+    { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11, 0x00 }, // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x00 }, // N
+    { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e, 0x00 }, // O
+    { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10, 0x00 }, // P
+    { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d, 0x00 }, // Q
+    { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11, 0x00 }, // R
+    { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e, 0x00 }, // S
+    { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 }, // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e, 0x00 }, // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04, 0x00 }, // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a, 0x00 }, // W
+    { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11, 0x00 }, // X
+    { 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04, 0x00 }, // Y
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f, 0x00 }, // Z
+    { 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e, 0x00 }, // [
+    { 0x10, 0x08, 0x08, 0x04, 0x02, 0x02, 0x01, 0x00 }, // backslash
+    { 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e, 0x00 }, // ]
+    { 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f }, // _
+    { 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x0e, 0x01, 0x0f, 0x11, 0x0f, 0x00 }, // a
+    { 0x10, 0x10, 0x1e, 0x11, 0x11, 0x11, 0x1e, 0x00 }, // b
+    { 0x00, 0x00, 0x0e, 0x10, 0x10, 0x11, 0x0e, 0x00 }, // c
+    { 0x01, 0x01, 0x0f, 0x11, 0x11, 0x11, 0x0f, 0x00 }, // d
+    { 0x00, 0x00, 0x0e, 0x11, 0x1f, 0x10, 0x0e, 0x00 }, // e
+    { 0x06, 0x09, 0x08, 0x1c, 0x08, 0x08, 0x08, 0x00 }, // f
+    { 0x00, 0x00, 0x0f, 0x11, 0x11, 0x0f, 0x01, 0x0e }, // g
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 }, // h
+    { 0x04, 0x00, 0x0c, 0x04, 0x04, 0x04, 0x0e, 0x00 }, // i
+    { 0x02, 0x00, 0x06, 0x02, 0x02, 0x02, 0x12, 0x0c }, // j
+    { 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12, 0x00 }, // k
+    { 0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e, 0x00 }, // l
+    { 0x00, 0x00, 0x1a, 0x15, 0x15, 0x15, 0x15, 0x00 }, // m
+    { 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 }, // n
+    { 0x00, 0x00, 0x0e, 0x11, 0x11, 0x11, 0x0e, 0x00 }, // o
+    { 0x00, 0x00, 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10 }, // p
+    { 0x00, 0x00, 0x0f, 0x11, 0x11, 0x0f, 0x01, 0x01 }, // q
+    { 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00 }, // r
+    { 0x00, 0x00, 0x0f, 0x10, 0x0e, 0x01, 0x1e, 0x00 }, // s
+    { 0x08, 0x08, 0x1c, 0x08, 0x08, 0x09, 0x06, 0x00 }, // t
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0d, 0x00 }, // u
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0a, 0x04, 0x00 }, // v
+    { 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0a, 0x00 }, // w
+    { 0x00, 0x00, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x00 }, // x
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0f, 0x01, 0x0e }, // y
+    { 0x00, 0x00, 0x1f, 0x02, 0x04, 0x08, 0x1f, 0x00 }, // z
+    { 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x00 }, // {
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 }, // |
+    { 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00 }, // }
+    { 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00 }, // ~
+};
+
+const std::uint8_t* glyph(char ch)
+{
+    return (ch >= ' ' && ch <= '~') ? FONT[ch - ' '] : FONT['?' - ' '];
+}
+
+// The layout of a rendered image: coordinates are in cells, from the top
+// left corner of the first cell, and are converted to pixels by px() and py()
+class Canvas {
+public:
+    Canvas(Image& image, int cellSize, double left, double top)
+        : image(image), cellSize(cellSize), left(left), top(top) {}
+
+    int px(double x) const { return static_cast<int>(std::lround((left + x) * cellSize)); }
+    int py(double y) const { return static_cast<int>(std::lround((top + y) * cellSize)); }
+
+    // Fill the pixels [x0, x1) x [y0, y1), clipped to the image
+    void fill(int x0, int y0, int x1, int y1, std::uint8_t grey)
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, image.width);
+        y1 = std::min(y1, image.height);
+        for (int y = y0; y < y1; ++y) {
+            std::fill(image.pixels.begin() + static_cast<std::size_t>(y) * image.width + x0,
+                      image.pixels.begin() + static_cast<std::size_t>(y) * image.width + x1, grey);
+        }
+    }
+
+    // A horizontal line from (x0, y) to (x1, y), or a vertical one from
+    // (x, y0) to (x, y1), of the given thickness in pixels
+    void hline(double x0, double x1, double y, int thickness)
+    {
+        int c = py(y) - thickness / 2;
+        fill(px(x0) - thickness / 2, c, px(x1) + (thickness + 1) / 2, c + thickness, 0);
+    }
+
+    void vline(double x, double y0, double y1, int thickness)
+    {
+        if (y0 > y1) {
+            std::swap(y0, y1);
+        }
+        int c = px(x) - thickness / 2;
+        fill(c, py(y0), c + thickness, py(y1), 0);
+    }
+
+    // Write text centred on (x, y), with each pixel of the font scaled to a
+    // square of the given size. The text is centred on the rows that its
+    // glyphs cover, so that e.g. an "x" sits in the middle of its cell.
+    void text(double x, double y, const std::string& s, int scale)
+    {
+        int firstRow = GLYPH_HEIGHT;
+        int lastRow = -1;
+        for (char ch : s) {
+            const std::uint8_t* g = glyph(ch);
+            for (int r = 0; r < GLYPH_HEIGHT; ++r) {
+                if (g[r] != 0) {
+                    firstRow = std::min(firstRow, r);
+                    lastRow = std::max(lastRow, r);
+                }
+            }
+        }
+        if (lastRow < 0) {
+            return;
+        }
+
+        int width = (static_cast<int>(s.size()) * (GLYPH_WIDTH + 1) - 1) * scale;
+        int x0 = px(x) - width / 2;
+        int y0 = py(y) - (lastRow - firstRow + 1) * scale / 2 - firstRow * scale;
+        for (std::size_t k = 0; k < s.size(); ++k) {
+            const std::uint8_t* g = glyph(s[k]);
+            int gx = x0 + static_cast<int>(k) * (GLYPH_WIDTH + 1) * scale;
+            for (int r = firstRow; r <= lastRow; ++r) {
+                for (int c = 0; c < GLYPH_WIDTH; ++c) {
+                    if (g[r] & (1 << (GLYPH_WIDTH - 1 - c))) {
+                        fill(gx + c * scale, y0 + r * scale, gx + (c + 1) * scale, y0 + (r + 1) * scale, 0);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    Image& image;
+    int cellSize;
+    double left;
+    double top;
+};
+
+// Line thicknesses in pixels, in proportion to the cell size as in the
+// figures drawn by csv2img.py (whose cells were 9 points wide)
+int thickness(int cellSize, double points)
+{
+    return std::max(1, static_cast<int>(std::lround(cellSize * points / 9.0)));
+}
+
+
+// Writes the bits of a deflate stream, least significant first
+class BitWriter {
+public:
+    explicit BitWriter(std::string& out) : out(out) {}
+
+    void put(std::uint32_t bits, int numBits)
+    {
+        buffer |= static_cast<std::uint64_t>(bits) << count;
+        count += numBits;
+        while (count >= 8) {
+            out.push_back(static_cast<char>(buffer & 0xff));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are packed starting from their most significant bit
+    void putCode(std::uint32_t code, int numBits)
+    {
+        std::uint32_t reversed = 0;
+        for (int b = 0; b < numBits; ++b) {
+            reversed |= ((code >> b) & 1) << (numBits - 1 - b);
+        }
+        put(reversed, numBits);
+    }
+
+    void flush()
+    {
+        if (count > 0) {
+            out.push_back(static_cast<char>(buffer & 0xff));
+        }
+        buffer = 0;
+        count = 0;
+    }
+
+private:
+    std::string& out;
+    std::uint64_t buffer = 0;
+    int count = 0;
+};
+
+// Write a literal/length symbol with the fixed Huffman code of deflate
+void putFixedSymbol(BitWriter& bits, int sym)
+{
+    if (sym < 144) {
+        bits.putCode(0x30 + sym, 8);
+    }
+    else if (sym < 256) {
+        bits.putCode(0x190 + sym - 144, 9);
+    }
+    else if (sym < 280) {
+        bits.putCode(sym - 256, 7);
+    }
+    else {
+        bits.putCode(0xc0 + sym - 280, 8);
+    }
+}
+
+// Compress data as a zlib stream. The rendered images consist mostly of long
+// runs of the same byte (more so after the PNG "up" filter), so a single
+// block with the fixed Huffman codes and matches at distance 1 compresses
+// them well enough, without the cost of searching for general matches.
+std::string zlibCompress(const std::string& data)
+{
+    static const int LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                         3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+    std::string out = "\x78\x01";
+    BitWriter bits(out);
+    bits.put(1, 1);  // the final block
+    bits.put(1, 2);  // compressed with the fixed codes
+
+    const std::size_t n = data.size();
+    std::size_t p = 0;
+    while (p < n) {
+        std::size_t run = 0;
+        if (p > 0) {
+            while (run < 258 && p + run < n && data[p + run] == data[p - 1]) {
+                ++run;
+            }
+        }
+        if (run < 3) {
+            putFixedSymbol(bits, static_cast<unsigned char>(data[p]));
+            ++p;
+            continue;
+        }
+        int code = 28;
+        while (LENGTH_BASE[code] > static_cast<int>(run)) {
+            --code;
+        }
+        putFixedSymbol(bits, 257 + code);
+        bits.put(static_cast<std::uint32_t>(run - LENGTH_BASE[code]), LENGTH_EXTRA[code]);
+        bits.putCode(0, 5);  // distance 1
+        p += run;
+    }
+    putFixedSymbol(bits, 256);
+    bits.flush();
+
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    for (std::size_t k = 0; k < n; ) {
+        // the sums cannot overflow within 5552 bytes
+        std::size_t end = std::min(n, k + 5552);
+        for ( ; k < end; ++k) {
+            a += static_cast<unsigned char>(data[k]);
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    std::uint32_t adler = (b << 16) | a;
+    for (int s = 24; s >= 0; s -= 8) {
+        out.push_back(static_cast<char>((adler >> s) & 0xff));
+    }
+    return out;
+}
+
+std::uint32_t crc32(const std::string& data, std::size_t from)
+{
+    static const std::array<std::uint32_t, 256> table = []() {
+        std::array<std::uint32_t, 256> t {};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    std::uint32_t c = 0xffffffff;
+    for (std::size_t k = from; k < data.size(); ++k) {
+        c = table[(c ^ static_cast<unsigned char>(data[k])) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffff;
+}
+
+void putBigEndian(std::string& out, std::uint32_t v)
+{
+    for (int s = 24; s >= 0; s -= 8) {
+        out.push_back(static_cast<char>((v >> s) & 0xff));
+    }
+}
+
+// Append a PNG chunk of the given type to out
+void putChunk(std::string& out, const char* type, const std::string& data)
+{
+    putBigEndian(out, static_cast<std::uint32_t>(data.size()));
+    std::size_t start = out.size();
+    out += type;
+    out += data;
+    putBigEndian(out, crc32(out, start));
+}
+
+} // namespace
+
+
+BracketLabel parseBracketLabel(const std::string& spec)
+{
+    // <above|below>:<start>:<end>:<text>, where the text may contain colons
+    std::size_t c1 = spec.find(':');
+    std::size_t c2 = (c1 == std::string::npos) ? c1 : spec.find(':', c1 + 1);
+    std::size_t c3 = (c2 == std::string::npos) ? c2 : spec.find(':', c2 + 1);
+    if (c3 == std::string::npos) {
+        throw std::invalid_argument(std::format("Invalid label specification: {}", spec));
+    }
+
+    BracketLabel label;
+    std::string position = spec.substr(0, c1);
+    if (position != "above" && position != "below") {
+        throw std::invalid_argument(std::format("Invalid label specification: {}", spec));
+    }
+    label.above = (position == "above");
+    try {
+        label.start = std::stoi(spec.substr(c1 + 1, c2 - c1 - 1));
+        label.end = std::stoi(spec.substr(c2 + 1, c3 - c2 - 1));
+    }
+    catch (const std::exception&) {
+        throw std::invalid_argument(std::format("Invalid label specification: {}", spec));
+    }
+    label.text = spec.substr(c3 + 1);
+    return label;
+}
+
+
+Image renderWorlds(const std::vector<std::vector<int>>& worlds, const RenderOptions& options)
+{
+    if (worlds.empty()) {
+        throw std::invalid_argument("There are no generations to render");
+    }
+    const int cellSize = options.cellSize;
+    if (cellSize < 1) {
+        throw std::invalid_argument(std::format("Cell size ({}) must be at least 1", cellSize));
+    }
+
+    // the margins are a quarter of a cell, plus a cell above and below for labels
+    const int rows = static_cast<int>(worlds.size());
+    const int cols = static_cast<int>(worlds[0].size());
+    const double margin = options.labels.empty() ? 0.25 : 1.25;
+    Image image;
+    image.width = static_cast<int>(std::lround((cols + 0.5) * cellSize));
+    image.height = static_cast<int>(std::lround((rows + 2 * margin) * cellSize));
+    image.pixels.assign(static_cast<std::size_t>(image.width) * image.height, 255);
+    Canvas canvas(image, cellSize, 0.25, margin);
+
+    // the glyphs of the figures are 6 points high in 9 point cells
+    const int scale = cellSize / 12;
+    const int gridLine = thickness(cellSize, 0.25);
+    const int underline = thickness(cellSize, 1.0);
+
+    for (int y = 0; y < rows; ++y) {
+        const std::vector<int>& world = worlds[y];
+        for (int x = 0; x < cols; ++x) {
+            if (options.grid) {
+                canvas.hline(x, x + 1, y, gridLine);
+                canvas.hline(x, x + 1, y + 1, gridLine);
+                canvas.vline(x, y, y + 1, gridLine);
+                canvas.vline(x + 1, y, y + 1, gridLine);
+            }
+
+            int v = (x < static_cast<int>(world.size())) ? world[x] : 0;
+            if (v == 0) {
+                continue;
+            }
+            if (cellSize < 8) {
+                canvas.fill(canvas.px(x), canvas.py(y), canvas.px(x + 1), canvas.py(y + 1), (v == X_MARK) ? 0 : 96);
+            }
+            else if (v == X_MARK) {
+                canvas.text(x + 0.5, y + 0.5, "x", std::max(1, scale));
+            }
+            else {
+                std::string digits = std::to_string(std::abs(static_cast<long long>(v)));
+                canvas.text(x + 0.5, y + 0.5, digits, std::max(1, scale));
+                if (v < 0) {
+                    double halfWidth = 0.2 * digits.size();
+                    canvas.hline(x + 0.5 - halfWidth, x + 0.5 + halfWidth, y + 0.9, underline);
+                }
+            }
+        }
+    }
+
+    const int bracketLine = thickness(cellSize, 0.8);
+    for (const BracketLabel& label : options.labels) {
+        double lineY = label.above ? -0.2 : rows + 0.35;
+        double capY = lineY + (label.above ? 0.15 : -0.15);
+        canvas.hline(label.start, label.end, lineY, bracketLine);
+        canvas.vline(label.start, lineY, capY, bracketLine);
+        canvas.vline(label.end, lineY, capY, bracketLine);
+        canvas.text((label.start + label.end) / 2.0, lineY + (label.above ? -0.45 : 0.45),
+            label.text, std::max(1, scale));
+    }
+
+    return image;
+}
+
+
+void writePng(std::ostream& os, const Image& image)
+{
+    // each row is stored either as it is or as its difference from the row
+    // above (the "up" filter), whichever is smaller by the usual heuristic
+    const std::size_t w = static_cast<std::size_t>(image.width);
+    std::string raw;
+    raw.reserve((w + 1) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        const std::uint8_t* row = image.pixels.data() + y * w;
+        const std::uint8_t* above = (y > 0) ? row - w : row;
+        long long costNone = 0;
+        long long costUp = 0;
+        for (std::size_t x = 0; x < w; ++x) {
+            costNone += std::abs(static_cast<std::int8_t>(row[x]));
+            if (y > 0) {
+                costUp += std::abs(static_cast<std::int8_t>(row[x] - above[x]));
+            }
+        }
+        if (y > 0 && costUp < costNone) {
+            raw.push_back(2);
+            for (std::size_t x = 0; x < w; ++x) {
+                raw.push_back(static_cast<char>(row[x] - above[x]));
+            }
+        }
+        else {
+            raw.push_back(0);
+            raw.append(reinterpret_cast<const char*>(row), w);
+        }
+    }
+
+    std::string out = "\x89PNG\r\n\x1a\n";
+    std::string header;
+    putBigEndian(header, static_cast<std::uint32_t>(image.width));
+    putBigEndian(header, static_cast<std::uint32_t>(image.height));
+    header += '\x08';       // 8 bits per sample
+    header += '\x00';       // greyscale
+    header.append(3, '\0'); // deflate compression, adaptive filtering, no interlace
+    putChunk(out, "IHDR", header);
+    putChunk(out, "IDAT", zlibCompress(raw));
+    putChunk(out, "IEND", "");
+    os.write(out.data(), static_cast<std::streamsize>(out.size()));
+}
+
+
+void writePpm(std::ostream& os, const Image& image)
+{
+    std::string out = std::format("P6\n{} {}\n255\n", image.width, image.height);
+    out.reserve(out.size() + image.pixels.size() * 3);
+    for (std::uint8_t grey : image.pixels) {
+        out.append(3, static_cast<char>(grey));
+    }
+    os.write(out.data(), static_cast<std::streamsize>(out.size()));
+}
+
+
+void saveImage(const std::string& filename, const Image& image)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("Unable to open output file {}", filename));
+    }
+    if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".ppm") == 0) {
+        writePpm(file, image);
+    }
+    else {
+        writePng(file, image);
+    }
+    if (!file.flush()) {
+        throw std::runtime_error(std::format("Unable to write output file {}", filename));
+    }
+}
@@ -0,0 +1,64 @@
+// render.h
+//
+// Rendering of the history of a universe (one row of cells per generation)
+// as an image in the style of the figures of Barricelli's 1954 paper, as
+// csv2img.py used to draw them: each number is written in its cell, with a
+// bar under negative numbers, each X_MARK as an "x", with optional grid
+// lines around the cells and bracket labels above or below columns of the
+// world.
+//
+// Images are greyscale, drawn with a built-in bitmap font, and written as
+// PNG or PPM files without any external libraries. With cells of fewer than
+// 8 pixels there is no room for the glyphs, so each occupied cell is filled
+// instead (black for an X_MARK, grey for a number), which gives an overview
+// of a long run or a large world.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// A bracket drawn above the first row or below the last one, from the left
+// edge of column start to the left edge of column end, with a label
+struct BracketLabel {
+    bool above = true;
+    int start = 0;
+    int end = 0;
+    std::string text;
+};
+
+// Parse a label specification of the form <above|below>:<start>:<end>:<text>.
+// Throws std::invalid_argument if it is not one.
+BracketLabel parseBracketLabel(const std::string& spec);
+
+struct RenderOptions {
+    int cellSize = 36;                  // width and height of a cell in pixels
+    bool grid = false;                  // draw lines around each cell
+    std::vector<BracketLabel> labels;
+};
+
+// An 8-bit greyscale image, in rows from the top (0 is black, 255 white)
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+// Render a sequence of worlds, one per row. Throws std::invalid_argument if
+// there are none, or the cell size is not positive.
+Image renderWorlds(const std::vector<std::vector<int>>& worlds, const RenderOptions& options);
+
+// Write an image to os (which should be opened in binary mode) as a PNG or
+// a binary PPM
+void writePng(std::ostream& os, const Image& image);
+void writePpm(std::ostream& os, const Image& image);
+
+// Write an image to a file: as a PPM if its name ends in ".ppm", otherwise
+// as a PNG. Throws std::runtime_error if the file cannot be written.
+void saveImage(const std::string& filename, const Image& image);
@@ -0,0 +1,226 @@
+// scenarios.cpp
+//
+// The initial configurations of each of the figures in Barricelli's 1954 paper.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "scenarios.h"
+#include "random_state.h"
+
+#include <format> // from C++20
+#include <stdexcept>
+
+
+Scenario makeScenario(int fig, unsigned int seed)
+{
+    Scenario s;
+    s.fig = fig;
+    s.seed = seed;
+
+    switch (fig) {
+        case 1: {
+            s.worldSize = 62;
+            s.numGens = 10;
+            s.norm = Norm::BASIC;
+            s.initState = {4,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,-3,0,0,0,0,0,0,0,0,0,0,5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,-1,0,0,0,0,0,0,0,2,0,0,0,0,-8,0};
+            break;
+        }
+        case 2: {
+            s.worldSize = 17;
+            s.numGens = 5;
+            s.norm = Norm::SYMBIOTIC;
+            s.initState = {4};
+            break;
+        }
+        case 3: {
+            s.worldSize = 13;
+            s.numGens = 7;
+            s.norm = Norm::SYMBIOTIC;
+            s.initState = {0,0,0,0,0,0,0,0,0,0,0,0,-2};
+            break;
+        }
+        case 4: {
+            s.worldSize = 20;
+            s.numGens = 10;
+            s.norm = Norm::SYMBIOTIC;
+            s.initState = {0,0,0,0,0,0,0,0,4,0,0,0,0,0,0,0,0,0,0,-3};
+            break;
+        }
+        case 5: {
+            s.worldSize = 11;
+            s.numGens = 5;
+            s.norm = Norm::SYMBIOTIC;
+            s.initState = {4,0,0,0,0,3,0,0,0,-2};
+            break;
+        }
+        case 6: {
+            s.worldSize = 20;
+            s.numGens = 12;
+            s.norm = Norm::EXCLUSION;
+            s.initState = {0,0,5,0,0,0,5,0,1,-3,1,-3};
+            break;
+        }
+        case 7: {
+            s.worldSize = 41;
+            s.numGens = 10;
+            s.norm = Norm::EXCLUSION;
+            s.initState = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,-3,1,-3,0,-3,1};
+            break;
+        }
+        case 8: {
+            s.worldSize = 59;
+            s.numGens = 17;
+            s.norm = Norm::EXCLUSION;
+            s.initState = {9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,0,0,0,0,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3};
+            break;
+        }
+        case 9: {
+            s.worldSize = 116;
+            s.numGens = 19;
+            s.norm = Norm::EXCLUSION;
+            s.initState = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,5,-11,1,-3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7,9,-11,1,-7};
+            break;
+        }
+        case 10: {
+            s.worldSize = 56;
+            s.numGens = 14;
+            s.norm = Norm::EXCLUSION;
+            s.initState = {9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,0,0,0,0,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7};
+            break;
+        }
+        case 11: {
+            s.worldSize = 84;
+            s.numGens = 11;
+            s.norm = Norm::EXCLUSION;
+            s.initState = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,5,-11,1,-7,0,0,0,0,0,0,0,0,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3,9,-11,1,-3};
+            break;
+        }
+        case 12: {
+            s.worldSize = 12;
+            s.numGens = 7;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {3,0,0,0,0,2,0,-4};
+            break;
+        }
+        case 13: {
+            s.worldSize = 6;
+            s.numGens = 2;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,-2,0,0,-5};
+            break;
+        }
+        case 14: {
+            s.worldSize = 8;
+            s.numGens = 2;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {3,0,0,2,0,0,0,-4};
+            break;
+        }
+        case 15: {
+            s.worldSize = 83;
+            s.numGens = 101;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,1,-1,0,0,-1,0,0,-1,0,0,0,1,0,0,1,0,-1,0,0,0,-1,1,1,-1,1,1,1,1,1,0,0,1,-1,1,0,0,-1,-1,0,1,1,-1,0,1,1,1,1,0,-1,-1,-1,0,0,0,-1,0,0,1,-1,0,-1,1,0,-1,0,0,-1,1,0,0,-1,1,-1,1,-1,-1,1,1,0,-1,1,1};
+            break;
+        }
+        case 16: {
+            s.worldSize = 12;
+            s.numGens = 6;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,1,-1};
+            break;
+        }
+        case 17: {
+            s.worldSize = 20;
+            s.numGens = 39;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,1,-2,1,1,-2,0,1,-2,1,1,-2};
+            break;
+        }
+        case 18: {
+            s.worldSize = 21;
+            s.numGens = 20;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,0,1,-1,0,0,1,1,-2,0,1,-2};
+            break;
+        }
+        case 19: {
+            s.worldSize = 21;
+            s.numGens = 3;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,0,0,0,4,0,0,0,-4};
+            break;
+        }
+        case 20: {
+            s.worldSize = 18;
+            s.numGens = 4;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,0,0,0,0,1,-3,1,-3,1,-3};
+            break;
+        }
+        case 21: {
+            s.worldSize = 19;
+            s.numGens = 4;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,0,3,0,0,-3};
+            break;
+        }
+        case 22: {
+            s.worldSize = 20;
+            s.numGens = 5;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,0,0,0,0,0,0,0,2,2,-2,-2};
+            break;
+        }
+        case 23: {
+            // Test case: run Figure 15 for the first 9 generations
+            s.worldSize = 83;
+            s.numGens = 9;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {0,1,-1,0,0,-1,0,0,-1,0,0,0,1,0,0,1,0,-1,0,0,0,-1,1,1,-1,1,1,1,1,1,0,0,1,-1,1,0,0,-1,-1,0,1,1,-1,0,1,1,1,1,0,-1,-1,-1,0,0,0,-1,0,0,1,-1,0,-1,1,0,-1,0,0,-1,1,0,0,-1,1,-1,1,-1,-1,1,1,0,-1,1,1};
+            break;
+        }
+        case 24: {
+            // Test case: initialise world with row 8 of Figure 15 and run for just one further generation
+            s.worldSize = 83;
+            s.numGens = 2;
+            s.norm = Norm::CONDITIONAL;
+            s.initState = {1,-1,1,-1,1,-1,1,0,0,1,0,0,1,4,-1,0,0,0,1,-1,1,-1,1,-1,1,-1,1,-1,1,-1,1,1,-1,1,-1,1,0,0,0,-1,1,-1,1,-1,1,-1,1,-1,1,-1,0,1,-1,1,-1,1,3,0,-4,0,-4,0,0,0,1,1,-1,1,-1,1,-1,1,X_MARK,X_MARK,X_MARK,1,-2,1,1,-2,0,1,0};
+            break;
+        }
+        case 25: {
+            // Test case: like Barricelli's Figure 15, where he started with a randomly assigned
+            // initial state using tosses of two coins => both heads were marked as a 1, both tails
+            // as -1, and mixed head/tail as 0. Here we use the same probability distribution but
+            // generate a new random state from the run's seed each time the test is called (see
+            // random_state.h, whose defaults are this distribution).
+
+            s.worldSize = 83;
+            s.numGens = 101;
+            s.norm = Norm::CONDITIONAL;
+            s.randomInit = true;
+
+            // returns "-1" 25% of time, "0" 50% and "1" 25%
+            s.initState = makeRandomState(s.worldSize, RandomStateOptions { .seed = seed });
+            break;
+        }
+        default: {
+            throw std::invalid_argument(std::format("Unexpected figure number encountered ({})", fig));
+        }
+    }
+
+    return s;
+}
+
+
+std::string getScenarioTitle(const Scenario& scenario)
+{
+    std::string title = std::format("Figure {}: {} reproduction for {} generations with universe size {}",
+        scenario.fig, getNormName(scenario.norm), scenario.numGens, scenario.worldSize);
+    if (scenario.randomInit) {
+        title += std::format(" (seed {})", scenario.seed);
+    }
+    return title;
+}
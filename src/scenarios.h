@@ -0,0 +1,35 @@
+// scenarios.h
+//
+// The initial configurations used to reproduce each of the figures in
+// Barricelli's 1954 paper, plus a few additional test cases.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <string>
+#include <vector>
+
+const int NUM_RULES = 25;
+
+struct Scenario {
+    int fig = 0;
+    int worldSize = 10;
+    int numGens = 10;
+    Norm norm = Norm::BASIC;
+    std::vector<int> initState;
+    bool randomInit = false;    // true if the initial state was generated from seed
+    unsigned int seed = 0;
+};
+
+// Return the configuration for the given figure number (1-22) or test case
+// (23-NUM_RULES). Scenarios with a random initial state draw it from seed.
+// Throws std::invalid_argument for an unknown figure number.
+Scenario makeScenario(int fig, unsigned int seed = 0);
+
+// The one-line description of a scenario printed above its text output
+std::string getScenarioTitle(const Scenario& scenario);
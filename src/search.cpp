@@ -0,0 +1,193 @@
+// search.cpp
+//
+// Implementation of the search over initial configurations declared in
+// search.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "search.h"
+#include "cycles.h"
+#include "random_state.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format> // from C++20
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Candidates are claimed by the workers this many at a time
+const long long BATCH_SIZE = 64;
+
+// Whether candidate a ranks above candidate b
+bool ranksAbove(const Candidate& a, const Candidate& b)
+{
+    return (a.fitness != b.fitness) ? a.fitness > b.fitness : a.index < b.index;
+}
+
+// Keep candidate c in best if it is among the n best seen so far. best is a
+// heap whose front is the lowest ranked of them.
+void keepIfBest(std::vector<Candidate>& best, Candidate&& c, int n)
+{
+    if (static_cast<int>(best.size()) < n) {
+        best.push_back(std::move(c));
+        std::push_heap(best.begin(), best.end(), ranksAbove);
+    }
+    else if (ranksAbove(c, best.front())) {
+        std::pop_heap(best.begin(), best.end(), ranksAbove);
+        best.back() = std::move(c);
+        std::push_heap(best.begin(), best.end(), ranksAbove);
+    }
+}
+
+// Species of organisms of at least two cells (a lone number is not an organism
+// in any interesting sense)
+bool isMultiCellular(const Species& sp)
+{
+    return sp.genome.size() >= 2;
+}
+
+} // namespace
+
+
+const std::vector<NamedFitness>& getFitnessFunctions()
+{
+    static const std::vector<NamedFitness> functions = {
+        { "persistence", "organism-generations of the most persistent species of at least two cells",
+            [](const Universe&, const Census& census) {
+                long long most = 0;
+                for (const auto& [h, sp] : census.getSpecies()) {
+                    if (isMultiCellular(sp)) {
+                        most = std::max(most, sp.organismGenerations);
+                    }
+                }
+                return static_cast<double>(most);
+            } },
+        { "diversity", "species of at least two cells alive at the end of the run",
+            [](const Universe&, const Census& census) {
+                long long n = 0;
+                for (const auto& [h, sp] : census.getSpecies()) {
+                    if (isMultiCellular(sp) && sp.count > 0) {
+                        ++n;
+                    }
+                }
+                return static_cast<double>(n);
+            } },
+        { "population", "organisms alive at the end of the run",
+            [](const Universe&, const Census& census) {
+                return static_cast<double>(census.getNumOrganisms());
+            } },
+    };
+    return functions;
+}
+
+
+Fitness getFitness(const std::string& name)
+{
+    for (const NamedFitness& f : getFitnessFunctions()) {
+        if (f.name == name) {
+            return f.fitness;
+        }
+    }
+    throw std::invalid_argument(std::format("Unknown fitness function {}", name));
+}
+
+
+std::vector<int> makeCandidate(const SearchOptions& options, long long index)
+{
+    return makeRandomState(options.initLength,
+        RandomStateOptions { options.seed, static_cast<unsigned long long>(index), options.density, options.maxValue });
+}
+
+
+SearchResult search(const SearchOptions& options)
+{
+    if (options.worldSize < 1 || options.numGens < 1) {
+        throw std::invalid_argument("World size and number of generations must be at least 1");
+    }
+    if (options.initLength < 1 || options.initLength > options.worldSize) {
+        throw std::invalid_argument(std::format("Initial state length ({}) must be between 1 and the world size ({})",
+            options.initLength, options.worldSize));
+    }
+    if (options.maxValue < 1 || options.maxValue >= X_MARK) {
+        throw std::invalid_argument(std::format("Largest initial value ({}) must be between 1 and {}",
+            options.maxValue, X_MARK - 1));
+    }
+    if (!(options.density > 0.0 && options.density <= 1.0)) {
+        throw std::invalid_argument(std::format("Initial density ({}) must be in (0, 1]", options.density));
+    }
+    if (options.numCandidates < 0 || options.numBest < 1 || !options.fitness) {
+        throw std::invalid_argument("Invalid search options");
+    }
+
+    unsigned int numWorkers = options.numThreads ? options.numThreads
+                                                 : std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<long long> nextCandidate { 0 };
+    SearchResult result;
+    std::mutex resultMutex;
+
+    WorkStealingPool pool(numWorkers);
+    for (unsigned int w = 0; w < numWorkers; ++w) {
+        pool.submit([&]() {
+            // each worker's universes reuse the same buffers, one after another
+            std::pmr::unsynchronized_pool_resource memory;
+            SearchResult partial;
+            std::vector<Candidate> best;
+
+            for (long long first = nextCandidate.fetch_add(BATCH_SIZE); first < options.numCandidates;
+                 first = nextCandidate.fetch_add(BATCH_SIZE)) {
+                long long last = std::min(options.numCandidates, first + BATCH_SIZE);
+                for (long long k = first; k < last; ++k) {
+                    Candidate c { k, makeCandidate(options, k), 0.0 };
+                    Universe universe(options.worldSize, options.norm, c.initState, &memory);
+                    Census census(options.worldSize);
+                    CycleDetector cycles(static_cast<std::size_t>(options.worldSize));
+                    census.observe(universe);
+                    cycles.observe(universe);
+
+                    // a candidate that goes extinct or stops changing is pruned
+                    while (!cycles.found() || cycles.getKind() == CycleKind::PERIODIC) {
+                        if (universe.getGeneration() + 1 >= options.numGens) {
+                            break;
+                        }
+                        universe.step();
+                        ++partial.numGenerations;
+                        census.observe(universe);
+                        cycles.observe(universe);
+                    }
+
+                    if (cycles.getKind() == CycleKind::EXTINCT) {
+                        ++partial.numExtinct;
+                    }
+                    else if (cycles.getKind() == CycleKind::FIXED_POINT) {
+                        ++partial.numStatic;
+                    }
+                    else {
+                        ++partial.numSurvivors;
+                        c.fitness = options.fitness(universe, census);
+                        keepIfBest(best, std::move(c), options.numBest);
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+            result.numExtinct += partial.numExtinct;
+            result.numStatic += partial.numStatic;
+            result.numSurvivors += partial.numSurvivors;
+            result.numGenerations += partial.numGenerations;
+            for (Candidate& c : best) {
+                keepIfBest(result.best, std::move(c), options.numBest);
+            }
+        });
+    }
+    pool.wait();
+
+    std::sort(result.best.begin(), result.best.end(), ranksAbove);
+    return result;
+}
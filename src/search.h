@@ -0,0 +1,83 @@
+// search.h
+//
+// A search over random initial configurations for ones that give rise to
+// persistent or diverse symbioorganisms, such as those set up by hand for
+// Figures 8-11 and 15 of the paper.
+//
+// Candidate k of a search has an initial state drawn from (seed, k) (see
+// random_state.h), so any candidate can be regenerated on its own with
+// makeCandidate(). Each candidate is run for a number of generations while a
+// Census follows its organisms and a CycleDetector watches for it settling:
+// one that goes extinct or reaches a fixed point is pruned as soon as it
+// does, as nothing more can happen to it. The survivors are scored by a
+// fitness function of the universe and census at the end of the run, and the
+// best of them kept.
+//
+// The candidates are evaluated in parallel, by workers that claim them in
+// batches, each reusing one memory pool for its universes. The result does
+// not depend on the number of threads: candidates are ranked by fitness,
+// and ties are broken by candidate number.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "census.h"
+#include "universe.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// A fitness function: the score of a surviving candidate, given its
+// universe and census at the end of the run (higher is better)
+using Fitness = std::function<double(const Universe& universe, const Census& census)>;
+
+struct NamedFitness {
+    std::string name;
+    std::string description;
+    Fitness fitness;
+};
+
+// The built-in fitness functions
+const std::vector<NamedFitness>& getFitnessFunctions();
+
+// The built-in fitness function of the given name. Throws
+// std::invalid_argument if there is none.
+Fitness getFitness(const std::string& name);
+
+struct SearchOptions {
+    Norm norm = Norm::SYMBIOTIC;
+    int worldSize = 100;
+    int numGens = 200;             // generations each candidate is run for (including the first)
+    int initLength = 20;           // cells at the start of the world given random values
+    int maxValue = 10;             // magnitude of the largest number in an initial state
+    double density = 0.5;          // chance of each of those cells holding a number
+    long long numCandidates = 10000;
+    unsigned int seed = 0;
+    unsigned int numThreads = 0;   // 0 => one per hardware thread
+    int numBest = 20;              // candidates kept in the result
+    Fitness fitness = getFitness("persistence");
+};
+
+struct Candidate {
+    long long index = 0;
+    std::vector<int> initState;
+    double fitness = 0.0;
+};
+
+struct SearchResult {
+    std::vector<Candidate> best;   // the best survivors, best first
+    long long numExtinct = 0;      // candidates pruned as they went extinct ...
+    long long numStatic = 0;       // ... or reached a fixed point
+    long long numSurvivors = 0;
+    long long numGenerations = 0;  // generations computed over all candidates
+};
+
+// The initial state of candidate index of a search with the given options
+std::vector<int> makeCandidate(const SearchOptions& options, long long index);
+
+// Run a search. Throws std::invalid_argument for invalid options.
+SearchResult search(const SearchOptions& options);
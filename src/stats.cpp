@@ -0,0 +1,105 @@
+// stats.cpp
+//
+// Implementation of the generation statistics declared in stats.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "stats.h"
+
+#include <format> // from C++20
+#include <iterator>
+#include <ostream>
+#include <string>
+
+
+namespace {
+
+// Accumulate the statistics of the non-blank cells visited by forEach(f)
+template <typename ForEach>
+GenerationStats measure(ForEach&& forEach, int worldSize, long long generation,
+                        long long mutations, int histRange)
+{
+    GenerationStats stats;
+    stats.generation = generation;
+    stats.mutations = mutations;
+    stats.histogram.assign(2 * histRange + 1, 0);
+
+    forEach([&](int, int v) {
+        if (v == X_MARK) {
+            ++stats.xMarks;
+            return;
+        }
+        if (v > 0) {
+            ++stats.positive;
+        }
+        else {
+            ++stats.negative;
+        }
+        if (v < -histRange) {
+            ++stats.below;
+        }
+        else if (v > histRange) {
+            ++stats.above;
+        }
+        else {
+            ++stats.histogram[v + histRange];
+        }
+    });
+
+    stats.population = stats.positive + stats.negative;
+    stats.density = static_cast<double>(stats.population) / worldSize;
+    return stats;
+}
+
+} // namespace
+
+
+GenerationStats measureGeneration(const Universe& universe, int histRange)
+{
+    return measure([&](auto&& f) { universe.forEachNonBlank(f); },
+        universe.size(), universe.getGeneration(), universe.getMutations(), histRange);
+}
+
+
+GenerationStats measureState(const std::vector<int>& state, long long generation,
+                             long long mutations, int histRange)
+{
+    auto forEach = [&](auto&& f) {
+        for (std::size_t i = 0; i < state.size(); ++i) {
+            if (state[i] != 0) {
+                f(static_cast<int>(i), state[i]);
+            }
+        }
+    };
+    return measure(forEach, static_cast<int>(state.size()), generation, mutations, histRange);
+}
+
+
+void printStatsHeader(std::ostream& os, int histRange)
+{
+    std::string line = "generation,population,density,x_marks,positive,negative,mutations,below";
+    for (int v = -histRange; v <= histRange; ++v) {
+        if (v != 0) {
+            std::format_to(std::back_inserter(line), ",{}", v);
+        }
+    }
+    line += ",above\n";
+    os << line;
+}
+
+
+void printStats(std::ostream& os, const GenerationStats& stats)
+{
+    std::string line = std::format("{},{},{:.6g},{},{},{},{},{}", stats.generation, stats.population,
+        stats.density, stats.xMarks, stats.positive, stats.negative, stats.mutations, stats.below);
+    int histRange = static_cast<int>(stats.histogram.size()) / 2;
+    for (int k = 0; k < static_cast<int>(stats.histogram.size()); ++k) {
+        if (k != histRange) {
+            std::format_to(std::back_inserter(line), ",{}", stats.histogram[k]);
+        }
+    }
+    std::format_to(std::back_inserter(line), ",{}\n", stats.above);
+    os << line;
+}
@@ -0,0 +1,215 @@
+// threadpool.h
+//
+// A small work-stealing thread pool used by barricelli54 to run independent
+// simulations (e.g. the replicates of an ensemble) across all available cores.
+//
+// Each worker owns a deque of tasks, guarded by a lock of its own. Workers
+// pop tasks from the back of their own deque and, when that is empty, steal
+// from the front of the other workers' deques, so that a worker which
+// finishes its share of the runs early keeps busy until the whole batch is
+// done. No lock is shared by all the workers: the counts of outstanding
+// tasks are atomic, and an idle worker sleeps on an atomic counter that is
+// bumped whenever there is new work.
+//
+// forEachIndex() runs a loop body over a range of indices on the same
+// workers, which claim the indices one at a time with a compare-and-swap on
+// an atomic counter. It allocates nothing, so a universe stepping on the
+// pool runs each pass of a generation with it.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // Create a pool with numThreads workers (0 => one per hardware thread)
+    explicit WorkStealingPool(unsigned int numThreads = 0)
+    {
+        if (numThreads == 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned int t = 0; t < numThreads; ++t) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned int t = 0; t < numThreads; ++t) {
+            workers.emplace_back([this, t]() { workerLoop(t); });
+        }
+    }
+
+    // Runs the tasks still queued, then stops the workers
+    ~WorkStealingPool()
+    {
+        stopping = true;
+        signalWork(true);
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    // Queue a task. Tasks are dealt out round-robin to the workers' deques.
+    void submit(Task task)
+    {
+        ++pending;
+        std::size_t q = nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->m);
+            queues[q]->tasks.push_back(std::move(task));
+        }
+        signalWork(false);
+    }
+
+    // Block until every task submitted so far has finished
+    void wait()
+    {
+        for (std::size_t p = pending.load(); p != 0; p = pending.load()) {
+            pending.wait(p);
+        }
+    }
+
+    // Call f(k) for each k in [0, n) on the workers, returning when they have
+    // all finished. Only one thread at a time may call this, and never a worker.
+    template <typename F>
+    void forEachIndex(int n, F&& f)
+    {
+        if (n <= 0) {
+            return;
+        }
+        using Body = std::remove_reference_t<F>;
+        batchBody = [](void* context, int k) { (*static_cast<Body*>(context))(k); };
+        batchContext = const_cast<void*>(static_cast<const void*>(&f));
+        std::uint64_t batch = static_cast<std::uint64_t>(++batchNumber) << 32;
+        batchRemaining = n;
+        batchLimit = batch | static_cast<std::uint32_t>(n);
+        batchClaim = batch;     // publishes the loop to the workers
+        signalWork(true);
+
+        for (int r = batchRemaining.load(); r != 0; r = batchRemaining.load()) {
+            batchRemaining.wait(r);
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    // Wake one idle worker (or all of them)
+    void signalWork(bool all)
+    {
+        ++workSignal;
+        if (all) {
+            workSignal.notify_all();
+        }
+        else {
+            workSignal.notify_one();
+        }
+    }
+
+    // Claim an index of the forEachIndex() loop, if it has any left, and run it
+    bool runBatchIndex()
+    {
+        std::uint64_t claim = batchClaim.load();
+        std::uint64_t limit = batchLimit.load();
+        while ((claim >> 32) == (limit >> 32) && static_cast<std::uint32_t>(claim) < static_cast<std::uint32_t>(limit)) {
+            // the batch number in the claim makes sure the index is of the
+            // loop whose limit we read
+            if (batchClaim.compare_exchange_weak(claim, claim + 1)) {
+                batchBody(batchContext, static_cast<int>(static_cast<std::uint32_t>(claim)));
+                if (--batchRemaining == 0) {
+                    batchRemaining.notify_all();
+                }
+                return true;
+            }
+            limit = batchLimit.load();
+        }
+        return false;
+    }
+
+    // Take a task from the back of our own deque, or failing that steal one
+    // from the front of another worker's deque
+    bool tryTake(unsigned int self, Task& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queues[self]->m);
+            if (!queues[self]->tasks.empty()) {
+                task = std::move(queues[self]->tasks.back());
+                queues[self]->tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned int self)
+    {
+        while (true) {
+            // read before looking for work, so that work arriving after the
+            // look changes it and the wait below returns at once
+            unsigned int signal = workSignal.load();
+
+            if (runBatchIndex()) {
+                continue;
+            }
+            Task task;
+            if (tryTake(self, task)) {
+                task();
+                if (--pending == 0) {
+                    pending.notify_all();
+                }
+                continue;
+            }
+            if (stopping) {
+                return; // nothing left to run
+            }
+            workSignal.wait(signal);
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> nextQueue { 0 };
+    std::atomic<std::size_t> pending { 0 };     // tasks queued or running
+    std::atomic<unsigned int> workSignal { 0 }; // bumped whenever there is new work
+    std::atomic<bool> stopping { false };
+
+    // the loop run by forEachIndex(), if any: the claim and limit both hold
+    // the number of the loop in their top 32 bits, and the next index to
+    // claim and the number of indices in their bottom 32 bits
+    void (*batchBody)(void*, int) = nullptr;
+    void* batchContext = nullptr;
+    std::uint32_t batchNumber = 0;
+    std::atomic<std::uint64_t> batchClaim { 0 };
+    std::atomic<std::uint64_t> batchLimit { 0 };
+    std::atomic<int> batchRemaining { 0 };      // indices not yet finished
+};
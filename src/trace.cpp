@@ -0,0 +1,281 @@
+// trace.cpp
+//
+// Implementation of the binary trace format declared in trace.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "trace.h"
+#include "encoding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format> // from C++20
+#include <ostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char TRACE_MAGIC[8] = {'B','5','4','T','R','A','C','E'};
+const char INDEX_MAGIC[8] = {'B','5','4','I','N','D','E','X'};
+const std::uint32_t TRACE_VERSION = 1;
+const std::size_t HEADER_SIZE = 40;
+const std::size_t FOOTER_SIZE = 24;
+
+const char KEYFRAME = 'K';
+const char DELTA = 'D';
+
+} // namespace
+
+
+TraceWriter::TraceWriter(std::ostream& os, const TraceHeader& header)
+    : os(os), header(header)
+{
+    if (header.worldSize < 1) {
+        throw std::invalid_argument(std::format("Trace world size ({}) must be at least 1", header.worldSize));
+    }
+    if (header.keyframeInterval < 1) {
+        throw std::invalid_argument(std::format("Trace keyframe interval ({}) must be at least 1",
+            header.keyframeInterval));
+    }
+
+    record.assign(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    putFixed(record, TRACE_VERSION, 4);
+    putFixed(record, static_cast<std::uint32_t>(header.fig), 4);
+    putFixed(record, static_cast<std::uint32_t>(header.norm), 4);
+    putFixed(record, static_cast<std::uint32_t>(header.worldSize), 4);
+    putFixed(record, static_cast<std::uint32_t>(header.numGens), 4);
+    putFixed(record, header.randomInit ? 1 : 0, 4);
+    putFixed(record, header.seed, 4);
+    putFixed(record, static_cast<std::uint32_t>(header.keyframeInterval), 4);
+    os.write(record.data(), record.size());
+    pos = record.size();
+
+    prev.assign(header.worldSize, 0);
+    cur.assign(header.worldSize, 0);
+}
+
+
+void TraceWriter::append(const Universe& universe)
+{
+    if (universe.size() != header.worldSize) {
+        throw std::invalid_argument(std::format("Universe size ({}) does not match the trace ({})",
+            universe.size(), header.worldSize));
+    }
+    for (int i = 0; i < header.worldSize; ++i) {
+        cur[i] = universe.cell(i);
+    }
+    writeRecord();
+}
+
+
+void TraceWriter::append(const std::vector<int>& state)
+{
+    if (state.size() != static_cast<std::size_t>(header.worldSize)) {
+        throw std::invalid_argument(std::format("World size ({}) does not match the trace ({})",
+            state.size(), header.worldSize));
+    }
+    cur = state;
+    writeRecord();
+}
+
+
+// Encode cur as the next record (a keyframe or a delta from prev) and write it
+void TraceWriter::writeRecord()
+{
+    if (finished) {
+        throw std::logic_error("Cannot append to a finished trace");
+    }
+
+    record.clear();
+    int n = header.worldSize;
+    if (offsets.size() % header.keyframeInterval == 0) {
+        record.push_back(KEYFRAME);
+        putRuns(record, n, [this](int i) { return cur[i]; });
+    }
+    else {
+        record.push_back(DELTA);
+        std::string runs;
+        int numRuns = 0;
+        int lastEnd = 0;
+        for (int i = 0; i < n; ) {
+            if (cur[i] == prev[i]) {
+                ++i;
+                continue;
+            }
+            int run = 1;
+            while (i + run < n && cur[i + run] != prev[i + run]) {
+                ++run;
+            }
+            putVarint(runs, i - lastEnd);
+            putVarint(runs, run);
+            for (int k = i; k < i + run; ++k) {
+                putSigned(runs, cur[k]);
+            }
+            ++numRuns;
+            i += run;
+            lastEnd = i;
+        }
+        putVarint(record, numRuns);
+        record += runs;
+    }
+
+    offsets.push_back(pos);
+    os.write(record.data(), record.size());
+    pos += record.size();
+    prev.swap(cur);
+}
+
+
+void TraceWriter::finish()
+{
+    if (finished) {
+        return;
+    }
+    finished = true;
+
+    std::uint64_t indexOffset = pos;
+    record.clear();
+    for (std::uint64_t offset : offsets) {
+        putFixed(record, offset, 8);
+    }
+    putFixed(record, offsets.size(), 8);
+    putFixed(record, indexOffset, 8);
+    record.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    os.write(record.data(), record.size());
+    os.flush();
+
+    if (!os) {
+        throw std::runtime_error("Error writing trace");
+    }
+}
+
+
+TraceReader::TraceReader(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::format("Unable to open trace file {}", filename));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < HEADER_SIZE + FOOTER_SIZE) {
+        close(fd);
+        throw std::runtime_error(std::format("{} is not a trace file", filename));
+    }
+    fileSize = static_cast<std::size_t>(st.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error(std::format("Unable to map trace file {}", filename));
+    }
+    data = static_cast<const unsigned char*>(mapped);
+
+    const unsigned char* footer = data + fileSize - FOOTER_SIZE;
+    if (std::memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0
+        || std::memcmp(footer + 16, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        munmap(mapped, fileSize);
+        throw std::runtime_error(std::format("{} is not a complete trace file", filename));
+    }
+    std::uint32_t version = static_cast<std::uint32_t>(getFixed(data + 8, 4));
+    if (version != TRACE_VERSION) {
+        munmap(mapped, fileSize);
+        throw std::runtime_error(std::format("{} has unsupported trace version {}", filename, version));
+    }
+
+    header.fig = static_cast<int>(getFixed(data + 12, 4));
+    header.norm = static_cast<Norm>(getFixed(data + 16, 4));
+    header.worldSize = static_cast<int>(getFixed(data + 20, 4));
+    header.numGens = static_cast<int>(getFixed(data + 24, 4));
+    header.randomInit = (getFixed(data + 28, 4) & 1) != 0;
+    header.seed = static_cast<unsigned int>(getFixed(data + 32, 4));
+    header.keyframeInterval = static_cast<int>(getFixed(data + 36, 4));
+
+    numGens = static_cast<long long>(getFixed(footer, 8));
+    std::uint64_t indexOffset = getFixed(footer + 8, 8);
+    if (header.worldSize < 1 || header.keyframeInterval < 1 || numGens < 0
+        || indexOffset < HEADER_SIZE || indexOffset + 8 * static_cast<std::uint64_t>(numGens) != fileSize - FOOTER_SIZE) {
+        munmap(mapped, fileSize);
+        throw std::runtime_error(std::format("{} has a corrupt trace header or index", filename));
+    }
+    index = data + indexOffset;
+}
+
+
+TraceReader::~TraceReader()
+{
+    munmap(const_cast<unsigned char*>(data), fileSize);
+}
+
+
+std::vector<int> TraceReader::generation(long long g) const
+{
+    std::vector<int> state;
+    forEachGeneration(g, g + 1, [&](long long, const std::vector<int>& s) {
+        state = s;
+    });
+    return state;
+}
+
+
+void TraceReader::forEachGeneration(long long first, long long last,
+                                    const std::function<void(long long, const std::vector<int>&)>& f) const
+{
+    if (first < 0 || last > numGens || first > last) {
+        throw std::out_of_range(std::format("Generations [{}, {}) are not in the trace (which has {})",
+            first, last, numGens));
+    }
+
+    // start from the keyframe at or before the first generation wanted
+    std::vector<int> state(header.worldSize, 0);
+    for (long long g = first - first % header.keyframeInterval; g < last; ++g) {
+        decodeRecord(g, state);
+        if (g >= first) {
+            f(g, state);
+        }
+    }
+}
+
+
+// Decode the record of generation g, which turns state from generation g-1
+// (unless g is a keyframe) into generation g
+void TraceReader::decodeRecord(long long g, std::vector<int>& state) const
+{
+    std::uint64_t offset = getFixed(index + 8 * g, 8);
+    if (offset < HEADER_SIZE || offset >= static_cast<std::uint64_t>(index - data)) {
+        throw std::runtime_error(std::format("Corrupt index entry for generation {} of trace", g));
+    }
+    ByteDecoder in(data + offset, index);
+    int n = header.worldSize;
+
+    char type = in.getByte();
+    bool isKey = (g % header.keyframeInterval == 0);
+    if (type != (isKey ? KEYFRAME : DELTA)) {
+        throw std::runtime_error(std::format("Unexpected record type for generation {} of trace", g));
+    }
+
+    if (isKey) {
+        in.getRuns(n, [&](int begin, int end, int v) {
+            std::fill(state.begin() + begin, state.begin() + end, v);
+        });
+    }
+    else {
+        std::uint64_t numRuns = in.getVarint();
+        std::uint64_t i = 0;
+        for (std::uint64_t r = 0; r < numRuns; ++r) {
+            i += in.getVarint();
+            std::uint64_t run = in.getVarint();
+            if (i + run > static_cast<std::uint64_t>(n)) {
+                throw std::runtime_error(std::format("Corrupt delta for generation {} of trace", g));
+            }
+            for (std::uint64_t k = 0; k < run; ++k) {
+                state[i++] = in.getSigned();
+            }
+        }
+    }
+}
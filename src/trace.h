@@ -0,0 +1,113 @@
+// trace.h
+//
+// A compact binary format for the history of a universe, one generation after
+// another, from which any generation can be fetched without decoding the
+// whole file.
+//
+// A trace file consists of:
+//   - a header: the magic bytes "B54TRACE", the format version, and the
+//     metadata of the run (see TraceHeader)
+//   - one record per generation. Every keyframeInterval-th generation
+//     (starting with the first) is a keyframe holding the whole world,
+//     run-length encoded as (value, run length) pairs; the others are deltas
+//     holding just the runs of cells that changed since the previous
+//     generation, as (gap, run length, values...) entries
+//   - an index of the file offset of each generation's record
+//   - a footer: the number of generations, the offset of the index and the
+//     magic bytes "B54INDEX"
+// All integers in records are LEB128 varints (zigzag encoded where they may
+// be negative); the fixed-size fields of the header and footer are
+// little-endian. As the index and footer come last, a trace can be written
+// to a stream that cannot seek, such as standard output.
+//
+// A TraceReader memory-maps the file, so fetching generation g only decodes
+// the keyframe at or before it and the deltas up to it.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "universe.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct TraceHeader {
+    int fig = 0;                  // figure/test case number (0 if none)
+    Norm norm = Norm::BASIC;
+    int worldSize = 0;
+    int numGens = 0;              // number of generations the run was set up for
+    bool randomInit = false;      // true if the initial state was generated from seed
+    unsigned int seed = 0;
+    int keyframeInterval = 64;    // a keyframe is stored every this many generations
+};
+
+
+class TraceWriter {
+public:
+    // Start a trace on os (which should be opened in binary mode), writing
+    // its header straight away. Throws std::invalid_argument for a header
+    // with a non-positive world size or keyframe interval.
+    TraceWriter(std::ostream& os, const TraceHeader& header);
+
+    // Append the current generation of universe (or a world state) to the trace
+    void append(const Universe& universe);
+    void append(const std::vector<int>& state);
+
+    // Write the index and footer. Nothing can be appended afterwards.
+    // Throws std::runtime_error if the stream has failed.
+    void finish();
+
+    long long getNumGenerations() const { return static_cast<long long>(offsets.size()); }
+
+private:
+    void writeRecord();
+
+    std::ostream& os;
+    TraceHeader header;
+    std::uint64_t pos = 0;               // bytes written so far
+    std::vector<std::uint64_t> offsets;  // file offset of each generation's record
+    std::vector<int> prev;               // the previously appended generation
+    std::vector<int> cur;
+    std::string record;                  // encoding buffer, reused between records
+    bool finished = false;
+};
+
+
+class TraceReader {
+public:
+    // Open and memory-map a trace file. Throws std::runtime_error if the file
+    // cannot be read or is not a valid trace.
+    explicit TraceReader(const std::string& filename);
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    const TraceHeader& getHeader() const { return header; }
+    long long getNumGenerations() const { return numGens; }
+
+    // The state of the world in generation g (0 is the first one stored).
+    // Throws std::out_of_range if there is no such generation.
+    std::vector<int> generation(long long g) const;
+
+    // Call f(g, state) for each generation g in [first, last), decoding each
+    // record just once. Throws std::out_of_range for an invalid range.
+    void forEachGeneration(long long first, long long last,
+                           const std::function<void(long long, const std::vector<int>&)>& f) const;
+
+private:
+    void decodeRecord(long long g, std::vector<int>& state) const;
+
+    const unsigned char* data = nullptr;
+    std::size_t fileSize = 0;
+    TraceHeader header;
+    long long numGens = 0;
+    const unsigned char* index = nullptr;
+};
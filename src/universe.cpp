@@ -0,0 +1,1086 @@
+// universe.cpp
+//
+// Implementation of the Universe simulation engine declared in universe.h.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "universe.h"
+#include "basic_kernel.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <format> // from C++20
+#include <iostream>
+#include <stdexcept>
+
+
+// Detects when the sequence of cells visited by a reproduction chain starts to
+// repeat, using Brent's algorithm (so no per-cell bookkeeping is needed).
+//
+// Within one chain the next cell visited depends only on the current one
+// (j -> i + world[j]), so once a cell is revisited the chain is in a loop.
+// Every cell in such a loop continued the chain the first time round, so it
+// holds a number in the current world, and rewriting it is a no-op for all of
+// the symbiotic norms (it already holds the reproduced number or an X_MARK).
+// Stopping at the first detected repeat therefore gives exactly the same next
+// generation as following the loop until the level cap.
+class ChainCycleDetector {
+public:
+    explicit ChainCycleDetector(int first) : saved(first) {}
+
+    // Report the next cell j visited by the chain. Returns true if the
+    // chain has been detected to be repeating itself.
+    bool repeats(int j)
+    {
+        if (j == saved) {
+            return true;
+        }
+        if (steps == limit) {
+            saved = j;
+            limit *= 2;
+            steps = 0;
+        }
+        ++steps;
+        return false;
+    }
+
+private:
+    int saved;
+    int limit = 1;
+    int steps = 0;
+};
+
+
+std::string getNormName(Norm norm)
+{
+    switch (norm) {
+        case Norm::BASIC: return "basic";
+        case Norm::SYMBIOTIC: return "symbiotic";
+        case Norm::EXCLUSION: return "symbiotic+exclusion";
+        case Norm::CONDITIONAL: return "symbiotic+conditional";
+        default: {
+            throw std::invalid_argument(std::format("Encountered unknown norm {}", (int)norm));
+        }
+    }
+}
+
+
+// The norm policies. Each describes one norm to the generation loop
+// (Universe::stepWith<N, I>()), which is compiled separately for each of them,
+// so the reproduction chains of every norm are inlined into a loop of its own
+// and no norm pays for the tests of another:
+//   sourcesIncludeX     whether the norm reproduces from X_MARKs (and so
+//                       whether they are held in the occupancy map)
+//   needsOccupancy      whether a generation reads the occupancy map even in
+//                       dense mode (so it must be built before the parallel passes)
+//   updateWhole<I>(u)   compute the whole next generation at once if the norm
+//                       has a kernel for the universe's mode, returning false
+//                       if not (the reproductions from each cell are then followed)
+//   reproduce(u, i, w)  follow the reproductions from cell i, calling w(j, v)
+//                       for each write of value v into cell j, and return the
+//                       level reached by the reproduction chain (0 if none)
+//   write<I>(u, j, v)   apply a write of v into cell j of the next generation
+// An experimental norm is added as a new policy, with its own Norm value and
+// case in Universe::selectStepFunction(); the loops of the others are unchanged.
+
+// Basic update procedure, as described in Section 2 of (Barricelli, 1954)
+struct Universe::BasicNorm {
+    static constexpr bool sourcesIncludeX = true;
+    static constexpr bool needsOccupancy = false;
+
+    template <typename I>
+    static bool updateWhole(Universe& u)
+    {
+        if (u.sparse || I::enabled) {
+            // an instrumented universe visits the cells one by one, so that
+            // the writes are counted
+            return false;
+        }
+        // a dense world is handed to the whole-world kernel (vectorised if
+        // the CPU supports it, see basic_kernel.h)
+        static const BasicKernel fastestKernel = selectBasicKernel();
+        (u.vectorised ? fastestKernel : updateBasicScalar)(u.world, u.nextWorld);
+        return true;
+    }
+
+    template <typename Write>
+    static int reproduce(Universe& u, int i, Write&& write)
+    {
+        u.reproduceBasic(i, write);
+        return 0;
+    }
+
+    template <typename I>
+    static void write(Universe& u, int j, int v) { u.writeBasic<I>(j, v); }
+};
+
+// Symbiotic update procedure, as described in Section 4 of (Barricelli, 1954)
+struct Universe::SymbioticNorm {
+    static constexpr bool sourcesIncludeX = true;
+    static constexpr bool needsOccupancy = false;
+
+    template <typename I>
+    static bool updateWhole(Universe&) { return false; }
+
+    template <typename Write>
+    static int reproduce(Universe& u, int i, Write&& write)
+    {
+        // if this cell contains a number (not blank(0)), attempt to reproduce it
+        return u.world.isBlank(i) ? 0 : u.reproduceSymbiotic(i, i+u.world.get(i), write);
+    }
+
+    template <typename I>
+    static void write(Universe& u, int j, int v) { u.writeSymbiotic<I>(j, v); }
+};
+
+// Exclusion update procedure ("exclusion norm"), as described in Section 4 of (Barricelli, 1954)
+struct Universe::ExclusionNorm {
+    static constexpr bool sourcesIncludeX = false;
+    static constexpr bool needsOccupancy = false;
+
+    template <typename I>
+    static bool updateWhole(Universe&) { return false; }
+
+    template <typename Write>
+    static int reproduce(Universe& u, int i, Write&& write)
+    {
+        // if this cell contains a number (not blank(0) or X), attempt to reproduce it
+        return u.world.isNumber(i) ? u.reproduceExclusion(i, i+u.world.get(i), write) : 0;
+    }
+
+    template <typename I>
+    static void write(Universe& u, int j, int v) { u.writeExclusion<I>(j, v); }
+};
+
+// Conditional update procedure, as described in Section 5 of (Barricelli, 1954)
+struct Universe::ConditionalNorm {
+    static constexpr bool sourcesIncludeX = false;
+    static constexpr bool needsOccupancy = true;    // for findNearestNumber()
+
+    template <typename I>
+    static bool updateWhole(Universe&) { return false; }
+
+    template <typename Write>
+    static int reproduce(Universe& u, int i, Write&& write)
+    {
+        // if this cell contains a number (not blank(0) or X), attempt to reproduce it
+        return u.world.isNumber(i) ? u.reproduceConditional(i, i+u.world.get(i), write) : 0;
+    }
+
+    template <typename I>
+    static void write(Universe& u, int j, int v) { u.writeConditional<I>(j, v); }
+};
+
+Universe::Universe(int worldSize, Norm norm, const std::vector<int>& initlist, std::pmr::memory_resource* memory)
+    : worldSize(worldSize), norm(norm),
+      ownedMemory(memory ? nullptr : std::make_shared<std::pmr::synchronized_pool_resource>()),
+      memory(memory ? memory : ownedMemory.get()),
+      world(this->memory), nextWorld(this->memory), occupied(this->memory),
+      worldTouched(this->memory), nextTouched(this->memory),
+      crossWrites(this->memory), shardWrites(this->memory),
+      chunkMutations(this->memory), chunkCounters(this->memory)
+{
+    if (worldSize < 1) {
+        throw std::invalid_argument(std::format("World size ({}) must be at least 1", worldSize));
+    }
+    if (initlist.size() > static_cast<std::size_t>(worldSize)) {
+        throw std::invalid_argument(std::format("Initializer list size ({}) is bigger than world size ({})",
+            initlist.size(), worldSize));
+    }
+
+    // set world buffers to correct size and initialise elements to 0
+    world.assign(worldSize);
+    nextWorld.assign(worldSize);
+
+    // set initial world stated according to initlist
+    for (std::size_t i = 0; i < initlist.size(); ++i) {
+        world.set(static_cast<int>(i), initlist[i]);
+    }
+
+    setThreads(1);
+    selectStepFunction();
+}
+
+
+Universe::Universe(const Universe& other)
+    : worldSize(other.worldSize), norm(other.norm),
+      ownedMemory(std::make_shared<std::pmr::synchronized_pool_resource>()),
+      memory(ownedMemory.get()),
+      world(memory), nextWorld(memory),
+      generation(other.generation), mutations(other.mutations),
+      occupied(memory), occupiedValid(other.occupiedValid), occupiedIncludesX(other.occupiedIncludesX),
+      sparse(other.sparse), vectorised(other.vectorised),
+      worldTouched(memory), nextTouched(memory),
+      numThreads(other.numThreads), chunkSize(other.chunkSize), numChunks(other.numChunks),
+      crossWrites(memory), shardWrites(memory),
+      chunkMutations(memory), chunkCounters(memory),
+      counters(other.counters), instrumented(other.instrumented),
+      stepFunction(other.stepFunction)
+{
+    // the buffers are assigned rather than copy constructed, so that they
+    // keep this universe's memory
+    world = other.world;
+    nextWorld = other.nextWorld;
+    occupied = other.occupied;
+    worldTouched = other.worldTouched;
+    nextTouched = other.nextTouched;
+    crossWrites = other.crossWrites;
+    shardWrites = other.shardWrites;
+    chunkMutations = other.chunkMutations;
+    chunkCounters = other.chunkCounters;
+}
+
+
+void Universe::step()
+{
+    (this->*stepFunction)();
+}
+
+
+void Universe::setInstrumented(bool on)
+{
+    instrumented = on;
+    chunkCounters.assign(instrumented ? numChunks : 0, {});
+    selectStepFunction();
+}
+
+
+// Choose the generation loop compiled for the norm and instrumentation
+void Universe::selectStepFunction()
+{
+    switch (norm) {
+        case Norm::BASIC: {
+            stepFunction = stepFunctionFor<BasicNorm>();
+            occupiedIncludesX = BasicNorm::sourcesIncludeX;
+            break;
+        }
+        case Norm::SYMBIOTIC: {
+            stepFunction = stepFunctionFor<SymbioticNorm>();
+            occupiedIncludesX = SymbioticNorm::sourcesIncludeX;
+            break;
+        }
+        case Norm::EXCLUSION: {
+            stepFunction = stepFunctionFor<ExclusionNorm>();
+            occupiedIncludesX = ExclusionNorm::sourcesIncludeX;
+            break;
+        }
+        case Norm::CONDITIONAL: {
+            stepFunction = stepFunctionFor<ConditionalNorm>();
+            occupiedIncludesX = ConditionalNorm::sourcesIncludeX;
+            break;
+        }
+        default: {
+            throw std::invalid_argument(std::format("Encountered unknown norm {}", (int)norm));
+        }
+    }
+}
+
+
+template <typename N>
+Universe::StepFunction Universe::stepFunctionFor() const
+{
+    return instrumented ? &Universe::stepWith<N, Counted> : &Universe::stepWith<N, Uncounted>;
+}
+
+
+// Advance the universe by one generation under norm N, with instrumentation I
+template <typename N, typename I>
+void Universe::stepWith()
+{
+    std::chrono::steady_clock::time_point start;
+    if constexpr (I::enabled) {
+        start = std::chrono::steady_clock::now();
+    }
+
+    if (numThreads > 1) {
+        stepParallel<N, I>();
+    }
+    else {
+        update<N, I>();
+    }
+
+    flipWorlds();
+    ++generation;
+
+    if constexpr (I::enabled) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        countGeneration(elapsed.count());
+    }
+}
+
+
+// Add the counts of each chunk in the generation just computed, which took
+// the given wall time, to the universe's totals
+void Universe::countGeneration(double seconds)
+{
+    for (Counters& k : chunkCounters) {
+        counters.addCounts(k);
+        k = {};
+    }
+    counters.mutations += mutations;
+
+    counters.minSeconds = (counters.generations > 0) ? std::min(counters.minSeconds, seconds) : seconds;
+    counters.maxSeconds = std::max(counters.maxSeconds, seconds);
+    counters.seconds += seconds;
+    ++counters.generations;
+}
+
+
+void Universe::run(int numSteps, const std::function<void(const Universe&)>& onGeneration)
+{
+    for (int n = 0; n < numSteps; ++n) {
+        step();
+        if (onGeneration) {
+            onGeneration(*this);
+        }
+    }
+}
+
+
+std::vector<int> Universe::state() const
+{
+    std::vector<int> result(worldSize);
+    for (int i = 0; i < worldSize; ++i) {
+        result[i] = world.get(i);
+    }
+    return result;
+}
+
+
+std::uint64_t Universe::stateHash() const
+{
+    // the splitmix64 finaliser, applied to the cell index and value
+    auto mix = [](int i, int v) {
+        std::uint64_t z = (std::uint64_t(static_cast<std::uint32_t>(i)) << 32) | static_cast<std::uint32_t>(v);
+        z += 0x9e3779b97f4a7c15;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    };
+
+    std::uint64_t h = 0;
+    forEachNonBlank([&](int i, int v) {
+        h ^= mix(i, v);
+    });
+    return h;
+}
+
+
+void Universe::setSparse(bool on)
+{
+    if (on == sparse) {
+        return;
+    }
+    sparse = on;
+
+    if (sparse) {
+        // start tracking which cells of each world buffer have been written
+        // (between generations the next world is entirely blank)
+        int numWords = (worldSize + 63) / 64;
+        worldTouched.assign(numWords, 0);
+        nextTouched.assign(numWords, 0);
+        for (int i = 0; i < worldSize; ++i) {
+            if (!world.isBlank(i)) {
+                worldTouched[i >> 6] |= std::uint64_t(1) << (i & 63);
+            }
+        }
+    }
+    else {
+        worldTouched.clear();
+        nextTouched.clear();
+    }
+    occupiedValid = false;
+}
+
+
+void Universe::setThreads(unsigned int n)
+{
+    if (n == 0) {
+        throw std::invalid_argument("Number of threads must be at least 1");
+    }
+    numThreads = n;
+
+    if (pool && pool->size() != numThreads) {
+        // threadPool() starts one of the new size when it is next needed
+        pool.reset();
+    }
+
+    if (numThreads == 1) {
+        chunkSize = (worldSize + 63) & ~63;
+    }
+    else {
+        // a few chunks per thread evens out the load when the occupied cells
+        // are unevenly spread; chunks are whole 64-cell words so that each
+        // word of an occupancy or touched bitmap belongs to a single chunk
+        int target = (worldSize + 4 * numThreads - 1) / (4 * numThreads);
+        chunkSize = std::max(64, (target + 63) & ~63);
+    }
+    numChunks = (worldSize + chunkSize - 1) / chunkSize;
+    crossWrites.assign(static_cast<std::size_t>(numChunks) * numChunks, {});
+    chunkMutations.assign(numChunks, 0);
+    chunkCounters.assign(instrumented ? numChunks : 0, {});
+}
+
+
+void Universe::setCell(int i, int v)
+{
+    if (i < 0 || i >= worldSize) {
+        throw std::invalid_argument(std::format("Cell {} is outside the world (size {})", i, worldSize));
+    }
+    world.set(i, v);
+    if (sparse) {
+        worldTouched[i >> 6] |= std::uint64_t(1) << (i & 63);
+    }
+    occupiedValid = false;
+}
+
+
+WorkStealingPool& Universe::threadPool()
+{
+    if (!pool) {
+        pool = std::make_shared<WorkStealingPool>(numThreads);
+    }
+    return *pool;
+}
+
+
+// Call f(c) for each chunk c of the world, spread across the thread pool if
+// there is more than one thread, returning when they have all finished
+template <typename F>
+void Universe::forEachChunk(F&& f)
+{
+    if (numThreads > 1) {
+        threadPool().forEachIndex(numChunks, f);
+    }
+    else {
+        for (int c = 0; c < numChunks; ++c) {
+            f(c);
+        }
+    }
+}
+
+
+void Universe::flipWorlds()
+{
+    world.swap(nextWorld);
+
+    mutations = 0;
+    for (long long& m : chunkMutations) {
+        mutations += m;
+        m = 0;
+    }
+
+    if (sparse) {
+        // the old world is now in nextWorld; only the cells written while it
+        // was being built can be non-blank, so just blank those
+        worldTouched.swap(nextTouched);
+        int wordsPerChunk = chunkSize / 64;
+        forEachChunk([&](int c) {
+            int wEnd = std::min(static_cast<int>(nextTouched.size()), (c + 1) * wordsPerChunk);
+            for (int w = c * wordsPerChunk; w < wEnd; ++w) {
+                for (std::uint64_t bits = nextTouched[w]; bits != 0; bits &= bits - 1) {
+                    nextWorld.set((w << 6) + std::countr_zero(bits), 0);
+                }
+                nextTouched[w] = 0;
+            }
+        });
+    }
+    else {
+        forEachChunk([&](int c) {
+            nextWorld.clear(c * chunkSize, std::min(worldSize, (c + 1) * chunkSize));
+        });
+    }
+
+    occupiedValid = false;
+}
+
+
+// Make sure the occupancy map describes the current world. The map holds the
+// cells that the current norm reproduces from: all non-blank cells for the
+// basic and symbiotic norms, and just the numbers (not X_MARKs) for the others
+// (see sourcesIncludeX in the norm policies).
+void Universe::updateOccupied()
+{
+    if (!occupiedValid) {
+        int wordsPerChunk = chunkSize / 64;
+        occupied.resize(worldSize);
+        forEachChunk([&](int c) {
+            int wBegin = c * wordsPerChunk;
+            int wEnd = std::min(occupied.numWords(), wBegin + wordsPerChunk);
+            if (sparse) {
+                occupied.fillWordsFrom(world, worldTouched, wBegin, wEnd, occupiedIncludesX);
+            }
+            else {
+                occupied.fillWords(world, wBegin, wEnd, occupiedIncludesX);
+            }
+        });
+        occupied.linkWords();
+        occupiedValid = true;
+    }
+}
+
+
+// Call f(i) for each cell i of the current world in index order. In sparse
+// mode the blank cells (and, where the norm ignores them, X_MARKs) are
+// skipped, as none of the norms reproduces anything from them.
+template <typename F>
+void Universe::forEachSource(F&& f)
+{
+    if (sparse) {
+        updateOccupied();
+        occupied.forEach(f);
+    }
+    else {
+        for (int i=0; i<worldSize; ++i) {
+            f(i);
+        }
+    }
+}
+
+
+// As forEachSource(), but only for the cells of chunk c. The occupancy map
+// must already be up to date in sparse mode, as this is called concurrently.
+template <typename F>
+void Universe::forEachSourceInChunk(int c, F&& f)
+{
+    if (sparse) {
+        int wordsPerChunk = chunkSize / 64;
+        occupied.forEachInWords(c * wordsPerChunk, std::min(occupied.numWords(), (c + 1) * wordsPerChunk), f);
+    }
+    else {
+        int end = std::min(worldSize, (c + 1) * chunkSize);
+        for (int i = c * chunkSize; i < end; ++i) {
+            f(i);
+        }
+    }
+}
+
+
+// As forEachSource(), but only for the cells [begin, end). The occupancy map
+// must already be up to date in sparse mode.
+template <typename F>
+void Universe::forEachSourceInRange(int begin, int end, F&& f)
+{
+    if (sparse) {
+        occupied.forEachInWords(begin / 64, (end + 63) / 64, [&](int i) {
+            if (i >= begin && i < end) {
+                f(i);
+            }
+        });
+    }
+    else {
+        for (int i = begin; i < end; ++i) {
+            f(i);
+        }
+    }
+}
+
+
+// Compute the next generation on the thread pool, for any norm.
+//
+// Every norm builds the next generation from a sequence of writes, in the
+// order of the cells they reproduce from (and, along a reproduction chain, in
+// the order of its hops). Where a write lands depends only on the current
+// world, but what it leaves there depends on what the cell already holds in
+// the next generation (e.g. a second, different number makes an X_MARK), so
+// writes to the same cell must be applied in the serial order; writes to
+// different cells are independent.
+//
+// In the first pass each chunk follows the reproductions from its own cells,
+// recording the writes that land in other chunks. In the second pass each
+// chunk applies the writes into it: first those recorded by lower chunks,
+// then its own (found by following its reproductions again), then those
+// recorded by higher chunks. That is exactly the serial order of the writes
+// into each cell, so the next generation is identical to the serial one.
+template <typename N, typename I>
+void Universe::stepParallel()
+{
+    if (sparse || N::needsOccupancy) {
+        // the chunks only read the map, so it must be built up front
+        updateOccupied();
+    }
+
+    forEachChunk([this](int c) {
+        std::pmr::vector<CellWrite>* out = &crossWrites[static_cast<std::size_t>(c) * numChunks];
+        for (int d = 0; d < numChunks; ++d) {
+            out[d].clear();
+        }
+        forEachSourceInChunk(c, [&](int i) {
+            // each chain is followed twice, so it is counted only in this pass
+            countChain<I>(i, N::reproduce(*this, i, [&](int j, int v) {
+                int d = j / chunkSize;
+                if (d != c) {
+                    out[d].push_back({j, v});
+                }
+            }));
+        });
+    });
+
+    forEachChunk([this](int d) {
+        auto applyFrom = [&](int c) {
+            for (const CellWrite& e : crossWrites[static_cast<std::size_t>(c) * numChunks + d]) {
+                N::template write<I>(*this, e.j, e.v);
+            }
+        };
+        for (int c = 0; c < d; ++c) {
+            applyFrom(c);
+        }
+        forEachSourceInChunk(d, [&](int i) {
+            N::reproduce(*this, i, [&](int j, int v) {
+                if (j / chunkSize == d) {
+                    N::template write<I>(*this, j, v);
+                }
+            });
+        });
+        for (int c = d + 1; c < numChunks; ++c) {
+            applyFrom(c);
+        }
+    });
+}
+
+
+void Universe::stepShard(int begin, int end, ShardLink& link)
+{
+    if (begin < 0 || begin >= end || end > worldSize) {
+        throw std::invalid_argument(std::format("Invalid shard [{}, {}) of a world of size {}", begin, end, worldSize));
+    }
+
+    switch (norm) {
+        case Norm::BASIC: {
+            stepShardWith<BasicNorm>(begin, end, link);
+            break;
+        }
+        case Norm::SYMBIOTIC: {
+            stepShardWith<SymbioticNorm>(begin, end, link);
+            break;
+        }
+        case Norm::EXCLUSION: {
+            stepShardWith<ExclusionNorm>(begin, end, link);
+            break;
+        }
+        case Norm::CONDITIONAL: {
+            stepShardWith<ConditionalNorm>(begin, end, link);
+            break;
+        }
+    }
+}
+
+
+// Compute the next generation of the shard [begin, end) under norm N. This is
+// stepParallel() with the shard as one chunk and the other shards' chunks
+// held by other universes: the writes from the shard into the others are
+// collected and exchanged, and the writes into the shard applied in the
+// serial order (from lower shards, from the shard itself, from higher shards).
+template <typename N>
+void Universe::stepShardWith(int begin, int end, ShardLink& link)
+{
+    if (sparse || N::needsOccupancy) {
+        updateOccupied();
+    }
+
+    shardWrites.clear();
+    forEachSourceInRange(begin, end, [&](int i) {
+        N::reproduce(*this, i, [&](int j, int v) {
+            if (j < begin || j >= end) {
+                shardWrites.push_back({j, v});
+            }
+        });
+    });
+
+    link.exchange(shardWrites);
+
+    for (const CellWrite& e : link.fromLower()) {
+        N::template write<Uncounted>(*this, e.j, e.v);
+    }
+    forEachSourceInRange(begin, end, [&](int i) {
+        N::reproduce(*this, i, [&](int j, int v) {
+            if (j >= begin && j < end) {
+                N::template write<Uncounted>(*this, j, v);
+            }
+        });
+    });
+    for (const CellWrite& e : link.fromHigher()) {
+        N::template write<Uncounted>(*this, e.j, e.v);
+    }
+
+    flipWorlds();
+    ++generation;
+}
+
+
+// Compute the next generation on the calling thread, under norm N
+template <typename N, typename I>
+void Universe::update()
+{
+    if (N::template updateWhole<I>(*this)) {
+        return;
+    }
+
+    forEachSource([this](int i) {
+        countChain<I>(i, N::reproduce(*this, i, [this](int j, int v) { N::template write<I>(*this, j, v); }));
+    });
+}
+
+
+// Helper function for the basic norm: the number at location i is copied to
+// the same position on the next line and reproduced in cell i + [contents of i]
+template <typename Write>
+void Universe::reproduceBasic(int i, Write&& write)
+{
+    int wi = world.get(i);
+    if (wi == 0) {
+        // a blank cell leaves the next line unchanged
+        return;
+    }
+
+    // copy state to same position on next line
+    write(i, wi);
+
+    // reproduce state elsewhere on next line
+    int c = i + wi;
+    if (c >= 0 && c < worldSize) {
+        write(c, wi);
+    }
+}
+
+
+// Write value v into cell j of the next generation under the basic norm
+template <typename I>
+void Universe::writeBasic(int j, int v)
+{
+    // collision rule for basic reproduction: a number arriving in an occupied
+    // cell is added to it, less the number in the cell above
+    countWrite<I>(j);
+    int nj = nextWorld.get(j);
+    setNext(j, (nj == 0) ? v : nj + (v - world.get(j)));
+}
+
+
+// Helper function for the symbiotic norm to implement
+// the symbiotic reproduction process.
+//
+// This function reproduces the number at location i in current world into
+// location j in the updated world (by calling write(j, number)). It then checks
+// whether location j is occupied in the current world - if it is, and its content
+// is not the same as at location i, then it goes on to reproduce the number
+// at location i into the location given by i offset by the content of
+// location j, and so on along the chain of hops.
+//
+// The chain is followed iteratively, and stops early if it starts to
+// repeat itself (see ChainCycleDetector) or after worldSize hops. Returns the
+// level (number of hops) reached.
+//
+template <typename Write>
+int Universe::reproduceSymbiotic(int i, int j, Write&& write)
+{
+    int wi = world.get(i);
+    ChainCycleDetector cycle(j);
+
+    // the level cap is a belt and braces guard against runaway chains
+    for (int level = 1; level <= worldSize; ++level) {
+        if ((j < 0) || (j >= worldSize)) {
+            return level;
+        }
+
+        int wj = world.get(j);
+        // reproduce number in cell i into cell j of next generation
+        write(j, wi);
+        // if the new contents of cell j comes below a different (non-zero) number,
+        // then reproduce it in cell (i + [contents of j])
+        if ((wj == 0) || (wj == wi)) {
+            return level;
+        }
+
+        j = i + wj;
+        if (cycle.repeats(j)) {
+            return level;
+        }
+    }
+    return worldSize;
+}
+
+
+// Write number v into cell j of the next generation under the symbiotic norm
+// (which overwrites whatever is there)
+template <typename I>
+void Universe::writeSymbiotic(int j, int v)
+{
+    countWrite<I>(j);
+    setNext(j, v);
+}
+
+
+// Helper function for the exclusion norm to implement
+// the exclusion norm.
+//
+// This function attempts to reproduce the number at location i in current world into
+// location j in the updated world (by calling write(j, number), see writeExclusion()).
+// Regardless of whether the number was copied or an X_MARK was written, the
+// function then checks whether location j is occupied in the current world - if it is,
+// and its content is not the same as at location i, then we go on to reproduce
+// the number at location i into the location given by i offset by the content
+// of location j, and so on along the chain of hops.
+//
+// The chain is followed iteratively, and stops early if it starts to
+// repeat itself (see ChainCycleDetector) or after worldSize hops. Returns the
+// level (number of hops) reached.
+//
+template <typename Write>
+int Universe::reproduceExclusion(int i, int j, Write&& write)
+{
+    int wi = world.get(i);
+    ChainCycleDetector cycle(j);
+
+    // the level cap is a belt and braces guard against runaway chains
+    for (int level = 1; level <= worldSize; ++level) {
+        if ((j < 0) || (j >= worldSize)) {
+            return level;
+        }
+
+        int wj = world.get(j);
+        write(j, wi);
+        if ((wj == 0) || (wj == X_MARK) || (wj == wi) || (i+wj == j)) {
+            // we only carry on if the new contents of cell j comes below a different
+            // (non-zero) number, in which case we reproduce it in cell (i + [contents of j]).
+            // The final condition in the line above (i+wj == j) ensures we don't waste our
+            // time trying to move into the same cell j as we have just handled.
+            return level;
+        }
+
+        j = i + wj;
+        if (cycle.repeats(j)) {
+            return level;
+        }
+    }
+    return worldSize;
+}
+
+
+// Write number v into cell j of the next generation under the exclusion norm.
+// If location j in the updated world is already occupied, and the contents is
+// different to the number we are trying to reproduce, then an exlusion mark
+// (X_MARK) is placed in location j instead.
+template <typename I>
+void Universe::writeExclusion(int j, int v)
+{
+    countWrite<I>(j);
+    int nj = nextWorld.get(j);
+    if (nj == 0) {
+        // the destination cell is blank, so go ahead
+        setNext(j, v);
+    }
+    else if (nj == v) {
+        // the destination cell contains the same number that we want to move
+        // to it, so do nothing in this case (the current number remains)
+    }
+    else {
+        // the destination cell is neither blank nor contains the same
+        // number that we want to move to it, so mark it with
+        // an exclusion mark
+        markNext<I>(j);
+    }
+}
+
+
+// Helper function for the conditional norm to implement
+// the conditional norm.
+//
+// This function attempts to reproduce the number at location i in current world into
+// location j in the updated world (by calling write(j, number), see writeConditional()).
+// Regardless of whether the number was copied or an X_MARK was written, the
+// function then checks whether location j is occupied in the current world - if it is,
+// and its content is not the same as at location i, then we go on to reproduce
+// the number at location i into the location given by i offset by the content
+// of location j, and so on along the chain of hops.
+//
+// The chain is followed iteratively, and stops early if it starts to
+// repeat itself (see ChainCycleDetector) or after worldSize hops. Returns the
+// level (number of hops) reached.
+//
+template <typename Write>
+int Universe::reproduceConditional(int i, int j, Write&& write)
+{
+    int wi = world.get(i);
+    ChainCycleDetector cycle(j);
+
+    // the level cap is a belt and braces guard against runaway chains
+    for (int level = 1; level <= worldSize; ++level) {
+        if ((j < 0) || (j >= worldSize)) {
+            return level;
+        }
+
+        int wj = world.get(j);
+        write(j, wi);
+        if ((wj == 0) || (wj == X_MARK) || (wj == wi) || ((i+wj) == j)) {
+            // we only carry on if the new contents of cell j comes below a different
+            // (non-zero) number, in which case we reproduce it in cell (i + [contents of j]).
+            // The final condition in the line above (i+wj == j) ensures we don't waste our
+            // time trying to move into the same cell j as we have just handled.
+            return level;
+        }
+
+        j = i + wj;
+        if (cycle.repeats(j)) {
+            return level;
+        }
+    }
+    return worldSize;
+}
+
+
+// Write number v into cell j of the next generation under the conditional norm.
+// If location j in the updated world is already occupied, and the contents is
+// different to the number we are trying to reproduce, then an exlusion mark
+// (X_MARK) is placed in location j instead.
+// If the exclusion mark falls under an empty cell, or another X_MARK, it is replaced
+// by a number equal to the distance between the nearest number to the left and the
+// nearest number to the right of the aforementioned empty cell. If the two said
+// numbers have the same sign, then the new number (distance) is given a positive
+// sign, otherwise a negative sign.
+template <typename I>
+void Universe::writeConditional(int j, int v)
+{
+    countWrite<I>(j);
+    int nj = nextWorld.get(j);
+    if (nj == 0) {
+        // the destination cell is blank, so go ahead
+        setNext(j, v);
+    }
+    else if (nj == v) {
+        // the destination cell contains the same number that we want to move
+        // to it, so do nothing in this case (the current number remains)
+    }
+    else {
+        // the destination cell contains a number different to the one we
+        // are attempting to move into it - so potentially mark it with X_MARK
+        // or produce a mutation
+
+        if (world.isNumber(j)) {
+            // the cell above our destination cell contains a number, so the
+            // place an X_MARK in the destination cell
+            markNext<I>(j);
+        }
+        else {
+            // the cell above our destination cell is either blank or
+            // contains an X_MARK, so consider placing a mutated number in
+            // the destination cell
+            auto [lpos, lnum] = findNearestNumber<I>(j, -1);
+            auto [rpos, rnum] = findNearestNumber<I>(j, 1);
+            if (lpos == X_MARK || rpos == X_MARK) {
+                // no number found to the left and/or right of the empty cell,
+                // so he destintaion cell gets an X_MARK
+                markNext<I>(j);
+            }
+            else {
+                // we found the closest numbers to the left and right of the
+                // empty cell, so the destination cell gets assigned a number
+                // corresponding to the distance between these two found cells.
+                // The sign of the assigned number is positive if the found numbers
+                // are of equal sign, or negative otherwise (the signs are
+                // compared rather than multiplied, as the product of two wide
+                // numbers can overflow)
+                setNext(j, (rpos-lpos) * (((lnum > 0) == (rnum > 0)) ? 1 : -1));
+                ++chunkMutations[j / chunkSize];
+            }
+        }
+    }
+}
+
+
+// Helper function to find the position of the nearest cell to cell i that is
+// occupied by a number. The paramater delta specifies the direction of the
+// search (1=right, -1=left).
+// Returns a FindResults object containing the index and contents of the
+// found cell, or {X_MARK, X_MARK} is the edge of the world is reached without
+// finding an occupied cell.
+//
+// Rather than scanning the world cell by cell, the search uses the occupancy
+// map of the current world (which for this norm holds exactly the cells
+// occupied by a number), built the first time it is needed in each generation.
+template <typename I>
+FindResult Universe::findNearestNumber(int i, int delta)
+{
+    assert(delta == 1 || delta == -1);
+
+    updateOccupied();
+
+    int pos = (delta < 0) ? occupied.nearestLeft(i) : occupied.nearestRight(i);
+    if constexpr (I::enabled) {
+        Counters& k = chunkCounters[i / chunkSize];
+        if (pos < 0) {
+            ++k.findMisses;
+        }
+        else {
+            ++k.findDistance[Counters::bin(std::abs(pos - i))];
+        }
+    }
+    if (pos < 0) {
+        return {X_MARK, X_MARK};
+    }
+
+    return {pos, world.get(pos)};
+}
+
+
+// Append the row of n cells whose values get(i) gives to line
+template <typename Get>
+static void appendRow(std::string& line, int n, Get get, bool csv)
+{
+    char buf[16];
+    for (int i = 0; i < n; ++i) {
+        int num = get(i);
+        if (csv) {
+            if (num == X_MARK) {
+                line += 'x';
+            }
+            else {
+                line.append(buf, std::to_chars(buf, buf + sizeof(buf), num).ptr);
+            }
+            if (i < n-1) {
+                line += ',';
+            }
+        }
+        else if (num == 0) {
+            line += "   ";
+        }
+        else if (num == X_MARK) {
+            line += "  x";
+        }
+        else {
+            // right-aligned in a field at least 3 characters wide
+            char* end = std::to_chars(buf, buf + sizeof(buf), num).ptr;
+            line.append(std::max(0, 3 - static_cast<int>(end - buf)), ' ');
+            line.append(buf, end);
+        }
+    }
+    line += '\n';
+}
+
+
+void printWorld(std::ostream& os, const Universe& universe, bool csv)
+{
+    printWorld(os, universe.state(), csv);
+}
+
+
+void printWorld(std::ostream& os, const std::vector<int>& world, bool csv)
+{
+    // the row is formatted into a buffer and written to os in one go
+    std::string line;
+    line.reserve(world.size() * 4 + 1);
+    appendRow(line, static_cast<int>(world.size()), [&](int i) { return world[i]; }, csv);
+    os << line;
+}
+
+
+void appendWorld(std::string& out, const CellBuffer& world, bool csv)
+{
+    appendRow(out, world.size(), [&](int i) { return world.get(i); }, csv);
+}
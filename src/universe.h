@@ -0,0 +1,328 @@
+// universe.h
+//
+// The simulation engine for barricelli54: a self-contained Universe object
+// holding one of Barricelli's one-dimensional numerical worlds, together with
+// the update procedures ("norms") described in his 1954 paper.
+//
+// A Universe owns all of its state, so any number of them can be created and
+// stepped independently (including concurrently on different threads) within
+// one process. The engine is built as the library libbarricelli54.a, which is
+// linked into the barricelli54 command line program.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "cell.h"
+#include "counters.h"
+#include "occupancy.h"
+
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+class WorkStealingPool;
+
+enum class Norm {
+    BASIC,
+    SYMBIOTIC,
+    EXCLUSION,
+    CONDITIONAL
+};
+
+struct FindResult {
+    int pos;
+    int num;
+};
+
+std::string getNormName(Norm norm);
+
+// A write of value v into cell j of the next generation
+struct CellWrite {
+    int j;
+    int v;
+};
+
+// The exchange of writes between the shards of a world whose generations are
+// computed in pieces, each shard by its own universe (see Universe::stepShard()
+// and distributed.h)
+class ShardLink {
+public:
+    virtual ~ShardLink() = default;
+
+    // Send the writes made from this shard into the others (in the order they
+    // were made), and receive those made into this shard by the others
+    virtual void exchange(std::span<const CellWrite> outgoing) = 0;
+
+    // The writes received into this shard from the shards below it and from
+    // those above it, each in the order they were made
+    virtual std::span<const CellWrite> fromLower() const = 0;
+    virtual std::span<const CellWrite> fromHigher() const = 0;
+};
+
+
+class Universe {
+public:
+    // Create a universe of worldSize cells updated according to the given norm.
+    // The first initlist.size() cells are set from initlist, the rest are blank.
+    // Throws std::invalid_argument if initlist does not fit in the universe.
+    //
+    // All of the universe's buffers are allocated from memory, which must
+    // outlive it (e.g. an arena or pool shared by many universes, which need
+    // not be synchronised if they are only ever stepped on one thread). By
+    // default the universe has a pool resource of its own. Once the buffers
+    // have grown to their working size, stepping the universe allocates no
+    // more memory: the two worlds are swapped and just their written cells
+    // blanked, and the few objects that come and go (e.g. the side table
+    // entries of wide values) are recycled by the pool. The exception is the
+    // side table itself, which grows whenever a world holds more wide values
+    // than any before it; under the basic norm, whose numbers keep growing,
+    // that can go on for many generations. (On more than one thread, the
+    // default pool keeps a pool per thread, and as the thread that writes a
+    // cell varies from run to run, one of them may still grow now and then.)
+    Universe(int worldSize, Norm norm, const std::vector<int>& initlist = {},
+             std::pmr::memory_resource* memory = nullptr);
+
+    // A universe can be copied or moved but not assigned to, as its buffers
+    // belong to its memory. A copy has buffers of its own, in a pool resource
+    // of its own whatever the memory of the original, and a thread pool of its
+    // own, started when it is first stepped on more than one thread.
+    Universe(const Universe& other);
+    Universe(Universe&&) = default;
+    Universe& operator=(const Universe&) = delete;
+    Universe& operator=(Universe&&) = delete;
+
+    // Advance the universe by one generation
+    void step();
+
+    // Advance the universe by numSteps generations, calling onGeneration (if
+    // provided) after each one
+    void run(int numSteps, const std::function<void(const Universe&)>& onGeneration = {});
+
+    int size() const { return worldSize; }
+    Norm getNorm() const { return norm; }
+    long long getGeneration() const { return generation; }
+
+    // Set the generation counter, e.g. when resuming a universe from a
+    // checkpoint of its state (see checkpoint.h)
+    void setGeneration(long long g) { generation = g; }
+
+    // The value of cell i of the current world (X_MARK denotes an exclusion mark)
+    int cell(int i) const { return world.get(i); }
+
+    // A copy of the current state of the world, one int per cell
+    std::vector<int> state() const;
+
+    // The current world in its compact storage (cheaper to copy than state())
+    const CellBuffer& cells() const { return world; }
+
+    // Call f(i, value) for each non-blank cell i of the current world, in
+    // increasing order of i. In sparse mode only the cells that may be
+    // non-blank are visited.
+    template <typename F>
+    void forEachNonBlank(F&& f) const
+    {
+        if (sparse) {
+            for (std::size_t w = 0; w < worldTouched.size(); ++w) {
+                for (std::uint64_t bits = worldTouched[w]; bits != 0; bits &= bits - 1) {
+                    int i = static_cast<int>(w << 6) + std::countr_zero(bits);
+                    if (!world.isBlank(i)) {
+                        f(i, world.get(i));
+                    }
+                }
+            }
+        }
+        else {
+            for (int i = 0; i < worldSize; ++i) {
+                if (!world.isBlank(i)) {
+                    f(i, world.get(i));
+                }
+            }
+        }
+    }
+
+    // The number of mutations (numbers placed by the conditional norm's
+    // mutation rule) made in computing the current generation
+    long long getMutations() const { return mutations; }
+
+    // A Zobrist-style hash of the current world: the XOR of a 64-bit hash of
+    // (i, value) for each non-blank cell i, so a blank world hashes to 0
+    std::uint64_t stateHash() const;
+
+    // The number of cells holding values too wide for the compact Cell storage
+    std::size_t numWideCells() const { return world.numWide(); }
+
+    // In sparse mode, each generation visits only the occupied cells of the
+    // world (found from a bit-packed occupancy map) rather than every cell, so
+    // its cost scales with the population rather than the size of the universe.
+    // The results are identical in either mode.
+    void setSparse(bool on);
+    bool isSparse() const { return sparse; }
+
+    // Whether the basic norm may use the vectorised kernel for the CPU (on by
+    // default; the results are identical either way)
+    void setVectorised(bool on) { vectorised = on; }
+
+    // Step the universe on numThreads threads (1, the default, steps it on the
+    // calling thread). The world is split into chunks of cells, and each
+    // generation is computed in two parallel passes: the first follows the
+    // reproductions from every chunk and collects the writes that land in
+    // other chunks, the second has each chunk apply, in the serial order, the
+    // writes landing in it. The results are identical for any number of threads.
+    void setThreads(unsigned int numThreads);
+    unsigned int getThreads() const { return numThreads; }
+
+    // Set cell i of the current world to v
+    void setCell(int i, int v);
+
+    // Advance just the shard [begin, end) of the world by one generation, as
+    // one of several universes that each compute a shard of the same world
+    // (see distributed.h). The shard's reproductions read only the cells within
+    // the largest magnitude of any value in the world of it and, under the
+    // conditional norm, the nearest numbers beyond those, so just these need
+    // to be up to date (see setCell()). The writes made from the shard into the
+    // others are exchanged through link for those made into it, and applied in
+    // the serial order, so the shard of the next generation is identical to
+    // the serial one; the rest of it is blank. The instrumentation counters
+    // are not updated. Throws std::invalid_argument for an invalid shard.
+    void stepShard(int begin, int end, ShardLink& link);
+
+    // Whether the universe updates its instrumentation counters (see
+    // counters.h) as it computes each generation (off by default, when the
+    // counting costs nothing)
+    void setInstrumented(bool on);
+    bool isInstrumented() const { return instrumented; }
+
+    // The instrumentation counters totalled over the generations computed
+    // while instrumented since the universe was created or they were last reset
+    const Counters& getCounters() const { return counters; }
+    void resetCounters() { counters = {}; }
+
+private:
+    // The norm policies (see universe.cpp), one per Norm
+    struct BasicNorm;
+    struct SymbioticNorm;
+    struct ExclusionNorm;
+    struct ConditionalNorm;
+
+    // The generation loop, compiled for each norm policy N and
+    // instrumentation policy I, and chosen when the norm or the
+    // instrumentation changes rather than in every generation
+    using StepFunction = void (Universe::*)();
+    void selectStepFunction();
+    template <typename N> StepFunction stepFunctionFor() const;
+    template <typename N, typename I> void stepWith();
+    template <typename N, typename I> void update();
+    template <typename N, typename I> void stepParallel();
+    template <typename N> void stepShardWith(int begin, int end, ShardLink& link);
+
+    void flipWorlds();
+    void updateOccupied();
+    template <typename F> void forEachChunk(F&& f);
+    template <typename F> void forEachSource(F&& f);
+    template <typename F> void forEachSourceInChunk(int c, F&& f);
+    template <typename F> void forEachSourceInRange(int begin, int end, F&& f);
+
+    template <typename Write> void reproduceBasic(int i, Write&& write);
+    template <typename I> void writeBasic(int j, int v);
+    template <typename Write> int reproduceSymbiotic(int i, int j, Write&& write);
+    template <typename I> void writeSymbiotic(int j, int v);
+    template <typename Write> int reproduceExclusion(int i, int j, Write&& write);
+    template <typename I> void writeExclusion(int j, int v);
+    template <typename Write> int reproduceConditional(int i, int j, Write&& write);
+    template <typename I> void writeConditional(int j, int v);
+    template <typename I> FindResult findNearestNumber(int i, int delta);
+    void countGeneration(double seconds);
+
+    // The pool that steps the universe on numThreads threads, started the
+    // first time it is needed
+    WorkStealingPool& threadPool();
+
+    // Count a reproduction chain from cell i that reached the given level
+    // (the basic norm, which has no chains, gives level 0)
+    template <typename I>
+    void countChain(int i, int level)
+    {
+        if constexpr (I::enabled) {
+            if (level > 0) {
+                ++chunkCounters[i / chunkSize].chainLength[Counters::bin(level)];
+            }
+        }
+    }
+
+    // Count a write into cell j of the next generation (before it is made)
+    template <typename I>
+    void countWrite(int j)
+    {
+        if constexpr (I::enabled) {
+            Counters& k = chunkCounters[j / chunkSize];
+            ++k.writes;
+            if (!nextWorld.isBlank(j)) {
+                ++k.collisions;
+            }
+        }
+    }
+
+    // Write an X_MARK into cell j of the next generation
+    template <typename I>
+    void markNext(int j)
+    {
+        if constexpr (I::enabled) {
+            ++chunkCounters[j / chunkSize].xMarks;
+        }
+        setNext(j, X_MARK);
+    }
+
+    // Write value v into cell j of the next generation
+    void setNext(int j, int v)
+    {
+        nextWorld.set(j, v);
+        if (sparse) {
+            nextTouched[j >> 6] |= std::uint64_t(1) << (j & 63);
+        }
+    }
+
+    int worldSize;
+    Norm norm;
+    std::shared_ptr<std::pmr::memory_resource> ownedMemory;  // the default pool (null if given memory)
+    std::pmr::memory_resource* memory;        // where the buffers below are allocated
+    CellBuffer world;
+    CellBuffer nextWorld;
+    long long generation = 0;
+    long long mutations = 0;
+    OccupancyMap occupied;      // cells of the current world that the norm reproduces from
+    bool occupiedValid = false; // whether occupied is up to date for this generation
+    bool occupiedIncludesX;     // whether the norm reproduces from X_MARKs (so occupied holds them)
+    bool sparse = false;
+    bool vectorised = true;
+    std::pmr::vector<std::uint64_t> worldTouched;  // sparse mode: cells of world that may be non-blank
+    std::pmr::vector<std::uint64_t> nextTouched;   // sparse mode: cells of nextWorld written so far
+    unsigned int numThreads = 1;
+    std::shared_ptr<WorkStealingPool> pool;   // null until first needed (see threadPool())
+    int chunkSize;                            // cells per chunk (a multiple of 64)
+    int numChunks;
+    std::pmr::vector<std::pmr::vector<CellWrite>> crossWrites;  // [c*numChunks+d]: writes from chunk c into chunk d
+    std::pmr::vector<CellWrite> shardWrites;       // stepShard(): writes from the shard into others
+    std::pmr::vector<long long> chunkMutations;    // mutations written into each chunk this generation
+    std::pmr::vector<Counters> chunkCounters;      // instrumentation counts of each chunk this generation
+    Counters counters;                        // instrumentation totals (see getCounters())
+    bool instrumented = false;
+    StepFunction stepFunction;
+};
+
+
+// Write the current state of the world as one line of output, either as
+// comma separated values or space separated and padded to align columns
+void printWorld(std::ostream& os, const Universe& universe, bool csv);
+void printWorld(std::ostream& os, const std::vector<int>& world, bool csv);
+
+// Append the line of output printWorld() writes for world to out
+void appendWorld(std::string& out, const CellBuffer& world, bool csv);
@@ -0,0 +1,253 @@
+// world_writer.cpp
+//
+// Implementation of the background writer of run output (see world_writer.h).
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#include "world_writer.h"
+#include "universe.h"
+
+#include <algorithm>
+#include <climits>
+#include <format> // from C++20
+#include <stdexcept>
+
+
+WorldWriter::WorldWriter(std::ostream& os, const WorldWriterOptions& options)
+    : os(os), options(options)
+{
+    if (options.every < 1 || options.numBuffers < 1) {
+        throw std::invalid_argument(std::format("Decimation ({}) and number of buffers ({}) must be at least 1",
+            options.every, options.numBuffers));
+    }
+    slots.resize(options.numBuffers);
+    batch.reserve(options.batchSize);
+    thread = std::thread([this]() { run(); });
+}
+
+
+WorldWriter::~WorldWriter()
+{
+    try {
+        finish();
+    }
+    catch (...) {
+    }
+}
+
+
+void WorldWriter::write(long long generation, const CellBuffer& world)
+{
+    if (generation % options.every != 0) {
+        return;
+    }
+    Slot& slot = claim();
+    slot.kind = Kind::ROW;
+    slot.world = world;
+    publish();
+}
+
+
+void WorldWriter::write(long long generation, const std::vector<int>& world)
+{
+    if (generation % options.every != 0) {
+        return;
+    }
+    Slot& slot = claim();
+    slot.kind = Kind::ROW;
+    slot.world.assign(static_cast<int>(world.size()));
+    for (std::size_t i = 0; i < world.size(); ++i) {
+        slot.world.set(static_cast<int>(i), world[i]);
+    }
+    publish();
+}
+
+
+void WorldWriter::skip(const CellBuffer& world)
+{
+    Slot& slot = claim();
+    slot.kind = Kind::SKIP;
+    slot.world = world;
+    publish();
+}
+
+
+void WorldWriter::skip(const std::vector<int>& world)
+{
+    Slot& slot = claim();
+    slot.kind = Kind::SKIP;
+    slot.world.assign(static_cast<int>(world.size()));
+    for (std::size_t i = 0; i < world.size(); ++i) {
+        slot.world.set(static_cast<int>(i), world[i]);
+    }
+    publish();
+}
+
+
+const CellBuffer* WorldWriter::lastWritten() const
+{
+    // the writer thread leaves last alone until it is given another world
+    return haveLast ? &last : nullptr;
+}
+
+
+void WorldWriter::flush()
+{
+    flushAndWait(Kind::FLUSH);
+}
+
+
+void WorldWriter::finish()
+{
+    if (thread.joinable()) {
+        try {
+            flushAndWait(Kind::STOP);
+        }
+        catch (...) {
+            // the writer thread has failed, and so returned
+            thread.join();
+            throw;
+        }
+        thread.join();
+    }
+    rethrowIfFailed();
+}
+
+
+WorldWriter::Slot& WorldWriter::claim()
+{
+    rethrowIfFailed();
+    long long p = published.load(std::memory_order_relaxed);
+    for (long long c = consumed.load(std::memory_order_acquire); p - c >= options.numBuffers;
+         c = consumed.load(std::memory_order_acquire)) {
+        consumed.wait(c, std::memory_order_acquire);
+    }
+    rethrowIfFailed();
+    return slots[p % options.numBuffers];
+}
+
+
+void WorldWriter::publish()
+{
+    published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    published.notify_one();
+}
+
+
+void WorldWriter::flushAndWait(Kind kind)
+{
+    claim().kind = kind;
+    publish();
+    ++flushesRequested;
+    for (long long f = flushed.load(std::memory_order_acquire); f < flushesRequested;
+         f = flushed.load(std::memory_order_acquire)) {
+        flushed.wait(f, std::memory_order_acquire);
+    }
+    rethrowIfFailed();
+}
+
+
+void WorldWriter::rethrowIfFailed()
+{
+    if (failed.load(std::memory_order_acquire)) {
+        std::rethrow_exception(error);
+    }
+}
+
+
+bool WorldWriter::differsFromLast(const CellBuffer& world) const
+{
+    if (!haveLast || world.size() != last.size()) {
+        return true;
+    }
+    if (!std::equal(world.data(), world.data() + world.size(), last.data())) {
+        return true;
+    }
+    // the codes match, but escaped cells may still hold different values
+    if (world.numWide() != 0) {
+        for (int i = 0; i < world.size(); ++i) {
+            if (world.data()[i] < CELL_MIN && world.get(i) != last.get(i)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+void WorldWriter::run()
+{
+    auto writeBatch = [this]() {
+        if (!batch.empty()) {
+            os.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            batch.clear();
+        }
+    };
+
+    bool stopping = false;
+    for (long long c = 0; !stopping; ++c) {
+        for (long long p = published.load(std::memory_order_acquire); p == c;
+             p = published.load(std::memory_order_acquire)) {
+            published.wait(p, std::memory_order_acquire);
+        }
+
+        Slot& slot = slots[c % options.numBuffers];
+        bool flushing = (slot.kind == Kind::FLUSH || slot.kind == Kind::STOP);
+        try {
+            switch (slot.kind) {
+                case Kind::ROW: {
+                    if (options.changedOnly) {
+                        if (!differsFromLast(slot.world)) {
+                            break;
+                        }
+                        appendWorld(batch, slot.world, options.csv);
+                        // the slot's buffer is refilled by the next write
+                        last.swap(slot.world);
+                        haveLast = true;
+                    }
+                    else {
+                        appendWorld(batch, slot.world, options.csv);
+                    }
+                    if (batch.size() >= options.batchSize) {
+                        writeBatch();
+                    }
+                    break;
+                }
+                case Kind::SKIP: {
+                    last.swap(slot.world);
+                    haveLast = true;
+                    break;
+                }
+                case Kind::FLUSH: {
+                    writeBatch();
+                    os.flush();
+                    break;
+                }
+                case Kind::STOP: {
+                    writeBatch();
+                    stopping = true;
+                    break;
+                }
+            }
+        }
+        catch (...) {
+            // release the simulation thread from any wait, for it to rethrow
+            error = std::current_exception();
+            failed.store(true, std::memory_order_release);
+            consumed.store(LLONG_MAX / 2, std::memory_order_release);
+            consumed.notify_all();
+            flushed.store(LLONG_MAX, std::memory_order_release);
+            flushed.notify_all();
+            return;
+        }
+
+        consumed.store(c + 1, std::memory_order_release);
+        consumed.notify_one();
+        if (flushing) {
+            flushed.fetch_add(1, std::memory_order_release);
+            flushed.notify_one();
+        }
+    }
+}
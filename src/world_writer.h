@@ -0,0 +1,112 @@
+// world_writer.h
+//
+// Writes the text or CSV output of a run (the lines of printWorld()) on a
+// background thread, so that the run is not held up by the terminal or the
+// disk. write() only copies the world (in its compact storage) into a slot of
+// a ring of generation buffers and returns; it waits only if every slot is
+// still waiting to be written. The writer thread formats the queued worlds
+// into one large buffer, which it writes to the stream in a single call once
+// it is full (and when the output is flushed or finished).
+//
+// The ring has a single producer (the thread running the simulation) and a
+// single consumer (the writer thread), which hand the slots to each other
+// through two atomic counters rather than a lock.
+//
+// The output can be decimated: only the generations that are a multiple of
+// every are written, and with changedOnly only those whose world differs
+// from the last one written. The rows of decimated output are not labelled
+// with their generation.
+//
+// This program is distributed under the GNU GPLv3 license. For full
+// information, see the LICENSE file included in the base directory of
+// this distribution.
+
+#pragma once
+
+#include "cell.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct WorldWriterOptions {
+    bool csv = false;
+    long long every = 1;                // write only the generations that are a multiple of this
+    bool changedOnly = false;           // write only worlds that differ from the last one written
+    int numBuffers = 64;                // slots in the ring of generation buffers
+    std::size_t batchSize = 1 << 20;    // bytes of output gathered before they are written
+};
+
+class WorldWriter {
+public:
+    // Start a writer thread writing to os, which nothing else may write to
+    // until finish() has returned. Throws std::invalid_argument for invalid
+    // options.
+    WorldWriter(std::ostream& os, const WorldWriterOptions& options);
+
+    // Finishes the output (ignoring errors)
+    ~WorldWriter();
+
+    WorldWriter(const WorldWriter&) = delete;
+    WorldWriter& operator=(const WorldWriter&) = delete;
+
+    // Queue the world of the given generation to be written (if it is not
+    // decimated). Rethrows any error of the writer thread.
+    void write(long long generation, const CellBuffer& world);
+    void write(long long generation, const std::vector<int>& world);
+
+    // Make world the last one written, without writing it, e.g. the last
+    // row written by the interrupted run of a resumed one
+    void skip(const CellBuffer& world);
+    void skip(const std::vector<int>& world);
+
+    // The last world written with changedOnly (null if none or without it).
+    // Only valid after flush(), until the next write.
+    const CellBuffer* lastWritten() const;
+
+    // Wait until everything queued has been written and os flushed.
+    // Rethrows any error of the writer thread.
+    void flush();
+
+    // Write everything queued and stop the writer thread, after which nothing
+    // more may be written. Rethrows any error of the writer thread.
+    void finish();
+
+private:
+    enum class Kind { ROW, SKIP, FLUSH, STOP };
+
+    struct Slot {
+        Kind kind = Kind::ROW;
+        CellBuffer world;
+    };
+
+    // The next free slot, once the writer thread has finished with it
+    Slot& claim();
+    // Hand the claimed slot to the writer thread
+    void publish();
+    // Request a flush of everything published so far, and wait for it
+    void flushAndWait(Kind kind);
+    void rethrowIfFailed();
+
+    // The writer thread
+    void run();
+    bool differsFromLast(const CellBuffer& world) const;
+
+    std::ostream& os;
+    WorldWriterOptions options;
+    std::vector<Slot> slots;
+    alignas(64) std::atomic<long long> published { 0 };   // slots handed to the writer thread
+    alignas(64) std::atomic<long long> consumed { 0 };    // slots it has finished with
+    std::atomic<long long> flushed { 0 };                 // flushes it has done
+    long long flushesRequested = 0;
+    std::atomic<bool> failed { false };
+    std::exception_ptr error;
+    CellBuffer last;                    // the last world written (with changedOnly)
+    bool haveLast = false;
+    std::string batch;
+    std::thread thread;
+};